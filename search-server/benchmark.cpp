@@ -0,0 +1,883 @@
+#include "benchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <sstream>
+#include <thread>
+
+#if defined(__unix__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "bulk_loader.h"
+#include "disk_index.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+template <typename Function>
+BenchmarkRecord Measure(string name, string variant, int threads, size_t operations, Function function) {
+    const auto start = Clock::now();
+    const size_t checksum = function();
+    return { move(name), move(variant), threads, operations, chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start), checksum, {} };
+}
+
+SearchServer BuildSearchServer(const vector<string>& dictionary, const vector<string>& documents) {
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    return search_server;
+}
+
+// Folds the ids and the relevance bits of every result in order, so equal checksums
+// mean the same documents with the same relevance in the same ranking order
+size_t HashResults(const vector<vector<Document>>& results) {
+    size_t checksum = 0;
+    for (const auto& documents : results) {
+        for (const Document& document : documents) {
+            uint64_t relevance_bits = 0;
+            memcpy(&relevance_bits, &document.relevance, sizeof(relevance_bits));
+            checksum = (checksum * 31 + static_cast<size_t>(document.id)) * 31 + static_cast<size_t>(relevance_bits);
+        }
+        checksum = checksum * 31 + documents.size();
+    }
+    return checksum;
+}
+
+template <typename ExecutionPolicy>
+size_t FindAll(const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+    size_t found = 0;
+    for (const string& query : queries) {
+        found += search_server.FindTopDocuments(policy, query).size();
+    }
+    return found;
+}
+
+// Every thread runs sequential searches over its own slice of the queries
+size_t FindAllOnThreads(const SearchServer& search_server, const vector<string>& queries, int thread_count) {
+    vector<size_t> found(thread_count);
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < queries.size(); i += thread_count) {
+                found[t] += search_server.FindTopDocuments(queries[i]).size();
+            }
+            });
+    }
+    for (auto& worker : threads) {
+        worker.join();
+    }
+    return accumulate(found.begin(), found.end(), size_t{ 0 });
+}
+
+template <typename ExecutionPolicy>
+size_t RemoveAll(SearchServer& search_server, ExecutionPolicy&& policy) {
+    const vector<int> ids(search_server.begin(), search_server.end());
+    for (const int id : ids) {
+        search_server.RemoveDocument(policy, id);
+    }
+    return ids.size();
+}
+
+template <typename ExecutionPolicy>
+size_t MatchAll(const SearchServer& search_server, const string& query, ExecutionPolicy&& policy) {
+    size_t word_count = 0;
+    for (const int document_id : search_server) {
+        const auto [words, status] = search_server.MatchDocument(policy, query, document_id);
+        word_count += words.size();
+    }
+    return word_count;
+}
+
+// Passes allocations to the upstream resource and counts them
+class CountingMemoryResource : public pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(pmr::memory_resource* upstream = pmr::new_delete_resource())
+        : upstream_(upstream) {
+    }
+
+    size_t GetAllocationCount() const {
+        return allocation_count_;
+    }
+
+    // Sum of all allocated sizes, released memory is not subtracted
+    size_t GetAllocatedBytes() const {
+        return allocated_bytes_;
+    }
+
+    size_t GetCurrentBytes() const {
+        return current_bytes_;
+    }
+
+    size_t GetPeakBytes() const {
+        return peak_bytes_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* const result = upstream_->allocate(bytes, alignment);
+        ++allocation_count_;
+        allocated_bytes_ += bytes;
+        const size_t current = current_bytes_ += bytes;
+        size_t peak = peak_bytes_;
+        while (current > peak && !peak_bytes_.compare_exchange_weak(peak, current)) {
+        }
+        return result;
+    }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+        current_bytes_ -= bytes;
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    pmr::memory_resource* upstream_;
+    atomic<size_t> allocation_count_ = 0;
+    atomic<size_t> allocated_bytes_ = 0;
+    atomic<size_t> current_bytes_ = 0;
+    atomic<size_t> peak_bytes_ = 0;
+};
+
+// Resident set size of the process, 0 where it is unknown
+size_t GetResidentBytes() {
+#if defined(__linux__)
+    ifstream statm("/proc/self/statm"s);
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (statm >> total_pages >> resident_pages) {
+        return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+// Runs the benchmark in a child forked from the current state of the process, so benchmarks
+// run one after another start from the same heap and their RSS does not depend on the order.
+// The function must not use parallel algorithms: the thread pool is not copied into the child.
+// Runs it in the process itself where fork is not available
+template <typename Function>
+BenchmarkRecord MeasureInChildProcess(Function function) {
+#if defined(__unix__)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+#if defined(__GLIBC__)
+            // Free pages inherited from the parent heap would hide the growth of the child
+            malloc_trim(0);
+#endif
+            const BenchmarkRecord record = function();
+            ostringstream out;
+            // Names and counters are single words, so the record is sent as words separated by spaces
+            out << record.name << ' ' << record.variant << ' ' << record.threads << ' ' << record.operations << ' ' << record.duration.count() << ' ' << record.checksum << ' ' << record.counters.size();
+            for (const auto& [name, value] : record.counters) {
+                out << ' ' << name << ' ' << value;
+            }
+            const string text = out.str();
+            for (size_t written = 0; written < text.size();) {
+                const ssize_t result = write(fds[1], text.data() + written, text.size() - written);
+                if (result <= 0) {
+                    _exit(1);
+                }
+                written += static_cast<size_t>(result);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        if (pid > 0) {
+            string text;
+            char buffer[4096];
+            for (ssize_t size; (size = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+                text.append(buffer, static_cast<size_t>(size));
+            }
+            close(fds[0]);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                throw runtime_error("Benchmark child process failed"s);
+            }
+            BenchmarkRecord record;
+            istringstream in(text);
+            int64_t duration = 0;
+            size_t counter_count = 0;
+            in >> record.name >> record.variant >> record.threads >> record.operations >> duration >> record.checksum >> counter_count;
+            record.duration = chrono::nanoseconds(duration);
+            record.counters.resize(counter_count);
+            for (auto& [name, value] : record.counters) {
+                in >> name >> value;
+            }
+            return record;
+        }
+        close(fds[0]);
+    }
+#endif
+    return function();
+}
+
+void PrintJsonString(ostream& out, string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+WordSampler::WordSampler(size_t word_count, double zipf_exponent)
+    : cumulative_weights_(word_count) {
+    double sum = 0.0;
+    for (size_t rank = 0; rank < word_count; ++rank) {
+        sum += 1.0 / pow(rank + 1.0, zipf_exponent);
+        cumulative_weights_[rank] = sum;
+    }
+}
+
+size_t WordSampler::operator()(mt19937_64& generator) const {
+    const double point = uniform_real_distribution<>(0.0, cumulative_weights_.back())(generator);
+    const auto it = upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+    return min<size_t>(it - cumulative_weights_.begin(), cumulative_weights_.size() - 1);
+}
+
+vector<string> GenerateDictionary(mt19937_64& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        const int length = uniform_int_distribution(1, max_length)(generator);
+        string word;
+        word.reserve(length);
+        for (int j = 0; j < length; ++j) {
+            word.push_back(static_cast<char>(uniform_int_distribution(0, 25)(generator) + 'a'));
+        }
+        words.push_back(move(word));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    // Ranks of the Zipf distribution must not follow the alphabetical order
+    shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+string GenerateQuery(mt19937_64& generator, const vector<string>& dictionary, const WordSampler& sampler, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[sampler(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937_64& generator, const vector<string>& dictionary, const WordSampler& sampler, int query_count, int word_count,
+    double minus_prob) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, sampler, word_count, minus_prob));
+    }
+    return queries;
+}
+
+vector<BenchmarkRecord> BenchmarkMatchDocuments(const SearchServer& search_server, const string& query) {
+    const size_t document_count = search_server.GetDocumentCount();
+    return {
+        Measure("MatchDocument"s, "seq"s, 1, document_count, [&] { return MatchAll(search_server, query, execution::seq); }),
+        Measure("MatchDocument"s, "par"s, 1, document_count, [&] { return MatchAll(search_server, query, execution::par); }),
+        Measure("MatchDocuments"s, "seq"s, 1, document_count, [&] {
+            return search_server.MatchDocuments(execution::seq, query, search_server).words.size();
+            }),
+        Measure("MatchDocuments"s, "par"s, 1, document_count, [&] {
+            return search_server.MatchDocuments(execution::par, query, search_server).words.size();
+            }),
+    };
+}
+
+vector<BenchmarkRecord> BenchmarkSharedScan(const SearchServer& search_server, const vector<string>& queries) {
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("SharedScan"s, "per-query"s, 1, queries.size(), [&] {
+        return HashResults(ProcessQueries(search_server, queries));
+        }));
+    records.push_back(Measure("SharedScan"s, "batched"s, 1, queries.size(), [&] {
+        return HashResults(ProcessQueriesBatched(search_server, queries));
+        }));
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkQueryModes(const SearchServer& search_server, const vector<string>& queries) {
+    vector<BenchmarkRecord> records;
+    for (const QueryMode mode : { QueryMode::ANY, QueryMode::ALL }) {
+        SearchOptions options;
+        options.mode = mode;
+        records.push_back(Measure("QueryMode"s, mode == QueryMode::ANY ? "any"s : "all"s, 1, queries.size(), [&] {
+            size_t found = 0;
+            for (const string& query : queries) {
+                found += search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, options).documents.size();
+            }
+            return found;
+            }));
+    }
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkFuzzySearch(const BenchmarkConfig& config) {
+    mt19937_64 generator(config.seed);
+    vector<BenchmarkRecord> records;
+    for (const int vocabulary_size : { config.dictionary_size, 10 * config.dictionary_size, 100 * config.dictionary_size }) {
+        const auto dictionary = GenerateDictionary(generator, vocabulary_size, config.max_word_length);
+        // Documents of ten consecutive dictionary words cover the whole dictionary
+        SearchServer search_server(""s);
+        for (size_t i = 0; i < dictionary.size(); i += 10) {
+            string document;
+            for (size_t j = i; j < min(i + 10, dictionary.size()); ++j) {
+                document += dictionary[j] + ' ';
+            }
+            document.pop_back();
+            search_server.AddDocument(static_cast<int>(i / 10), document, DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+
+        // Every query is a dictionary word with one letter replaced
+        vector<string> queries;
+        for (int i = 0; i < config.query_count; ++i) {
+            string word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+            word[uniform_int_distribution<size_t>(0, word.size() - 1)(generator)] = static_cast<char>(uniform_int_distribution(0, 25)(generator) + 'a');
+            queries.push_back(word + "~1"s);
+        }
+        records.push_back(Measure("FuzzySearch"s, "vocabulary="s + to_string(dictionary.size()), 1, queries.size(), [&] {
+            return FindAll(search_server, queries, execution::seq);
+            }));
+    }
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkQuantizedImpacts(const vector<string>& documents, const vector<string>& queries) {
+    SearchServerOptions options;
+    options.quantize_impacts = true;
+    SearchServer exact_server(""s);
+    SearchServer quantized_server(""s, options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        exact_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        quantized_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+
+    vector<vector<Document>> exact_results(queries.size());
+    vector<vector<Document>> quantized_results(queries.size());
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("QuantizedImpacts"s, "exact"s, 1, queries.size(), [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            exact_results[i] = exact_server.FindTopDocuments(queries[i]);
+            found += exact_results[i].size();
+        }
+        return found;
+        }));
+    records.push_back(Measure("QuantizedImpacts"s, "quantized"s, 1, queries.size(), [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            quantized_results[i] = quantized_server.FindTopDocuments<QuantizedTfIdfScorer>(queries[i]);
+            found += quantized_results[i].size();
+        }
+        return found;
+        }));
+
+    // Counts the compared top positions and the ones where the quantized ranking matches the exact one
+    size_t compared_positions = 0;
+    size_t same_top = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (size_t j = 0; j < min(exact_results[i].size(), quantized_results[i].size()); ++j) {
+            ++compared_positions;
+            same_top += exact_results[i][j].id == quantized_results[i][j].id ? 1 : 0;
+        }
+    }
+    records.back().counters = { { "compared_positions"s, compared_positions }, { "same_top"s, same_top } };
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkTieredPostings(const vector<string>& documents, const vector<string>& queries) {
+    SearchServerOptions options;
+    options.tiered_postings = true;
+    SearchServer exhaustive_server(""s);
+    SearchServer tiered_server(""s, options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        exhaustive_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        tiered_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+
+    // Equal checksums mean the same documents with the same relevance in the same order
+    auto find_all = [&queries](const SearchServer& search_server) {
+        vector<vector<Document>> results;
+        results.reserve(queries.size());
+        for (const string& query : queries) {
+            results.push_back(search_server.FindTopDocuments(query));
+        }
+        return HashResults(results);
+    };
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("TieredPostings"s, "exhaustive"s, 1, queries.size(), [&] {
+        return find_all(exhaustive_server);
+        }));
+    records.push_back(Measure("TieredPostings"s, "tiered"s, 1, queries.size(), [&] {
+        return find_all(tiered_server);
+        }));
+    const TierStats stats = tiered_server.GetTierStats();
+    records.back().counters = {
+        { "tier_bytes"s, tiered_server.GetMemoryStats().posting_tiers },
+        { "tier_hits"s, stats.hits },
+        { "tier_fallbacks"s, stats.fallbacks },
+    };
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkStopWords(const vector<string>& dictionary, const vector<string>& documents, size_t stop_word_count) {
+    // The first words of the dictionary have the highest ranks, as real stop words do
+    const set<string> stop_words(dictionary.begin(), dictionary.begin() + min(stop_word_count, dictionary.size()));
+    const StopWordSet stop_word_table(stop_words);
+    vector<string_view> words;
+    for (const string& document : documents) {
+        for (const string_view word : SplitIntoWords(document)) {
+            words.push_back(word);
+        }
+    }
+
+    // The checksum counts the stop words, so equal checksums mean equal answers
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("StopWords"s, "set"s, 1, words.size(), [&] {
+        return static_cast<size_t>(count_if(words.begin(), words.end(), [&stop_words](string_view word) {
+            return stop_words.count(static_cast<string>(word)) > 0;
+            }));
+        }));
+    records.push_back(Measure("StopWords"s, "perfect_hash"s, 1, words.size(), [&] {
+        return static_cast<size_t>(count_if(words.begin(), words.end(), [&stop_word_table](string_view word) {
+            return stop_word_table.Contains(word);
+            }));
+        }));
+    records.back().counters = { { "table_bytes"s, stop_word_table.GetTableBytes() } };
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkHotTerms(const vector<string>& documents, const vector<string>& queries, size_t hot_term_count) {
+    SearchServerOptions options;
+    options.hot_term_count = hot_term_count;
+    SearchServer scan_server(""s);
+    SearchServer cached_server(""s, options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        scan_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        cached_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+
+    // Equal checksums mean the same documents with the same relevance in the same order
+    auto find_all = [&queries](const SearchServer& search_server) {
+        vector<vector<Document>> results;
+        results.reserve(queries.size());
+        for (const string& query : queries) {
+            results.push_back(search_server.FindTopDocuments(query));
+        }
+        return HashResults(results);
+    };
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("HotTerms"s, "scan"s, 1, queries.size(), [&] {
+        return find_all(scan_server);
+        }));
+    records.push_back(Measure("HotTerms"s, "cached"s, 1, queries.size(), [&] {
+        return find_all(cached_server);
+        }));
+    const HotTermStats stats = cached_server.GetHotTermStats();
+    records.back().counters = {
+        { "hits"s, stats.hits },
+        { "misses"s, stats.misses },
+        { "evictions"s, stats.evictions },
+        { "cache_bytes"s, cached_server.GetMemoryStats().hot_terms },
+    };
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkAnytimeSearch(const vector<string>& documents, const vector<string>& queries) {
+    SearchServerOptions server_options;
+    server_options.tiered_postings = true;
+    SearchServer search_server(""s, server_options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+
+    vector<vector<Document>> exact_results(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        exact_results[i] = search_server.FindTopDocuments(queries[i]);
+    }
+    SearchOptions max_postings;
+    max_postings.max_postings = 3500;
+    SearchOptions time_budget;
+    time_budget.time_budget = chrono::milliseconds(5);
+
+    vector<BenchmarkRecord> records;
+    for (const auto& [variant, options] : { pair{ "exact"s, SearchOptions{} }, pair{ "max_postings=3500"s, max_postings },
+        pair{ "time_budget=5ms"s, time_budget } }) {
+        vector<SearchResult> results(queries.size());
+        records.push_back(Measure("AnytimeSearch"s, variant, 1, queries.size(), [&] {
+            size_t found = 0;
+            for (size_t i = 0; i < queries.size(); ++i) {
+                results[i] = search_server.FindTopDocuments(queries[i], DocumentStatus::ACTUAL, options);
+                found += results[i].documents.size();
+            }
+            return found;
+            }));
+        // Counts the approximate results and the positions where they match the exact ranking
+        size_t approximate = 0;
+        size_t same_top = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            approximate += results[i].is_approximate ? 1 : 0;
+            for (size_t j = 0; j < min(results[i].documents.size(), exact_results[i].size()); ++j) {
+                same_top += results[i].documents[j].id == exact_results[i][j].id ? 1 : 0;
+            }
+        }
+        records.back().counters = { { "approximate"s, approximate }, { "same_top"s, same_top } };
+    }
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkDiskIndex(const vector<string>& dictionary, const vector<string>& documents, const vector<string>& queries,
+    size_t memory_limit) {
+    const string path = (filesystem::temp_directory_path() / "search_server_benchmark.index").string();
+    const SearchServer search_server = BuildSearchServer(dictionary, documents);
+    vector<BenchmarkRecord> records;
+
+    DiskIndexBuildOptions options;
+    options.memory_limit = memory_limit;
+    DiskIndexBuilder builder(path, dictionary[0], options);
+    DiskIndexBuildStats stats;
+    records.push_back(Measure("DiskIndex"s, "build"s, 1, documents.size(), [&] {
+        for (size_t i = 0; i < documents.size(); ++i) {
+            builder.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        stats = builder.Finish();
+        return stats.documents;
+        }));
+    records.back().counters = {
+        { "memory_limit"s, memory_limit },
+        { "peak_run_bytes"s, stats.peak_run_bytes },
+        { "in_memory_index_bytes"s, search_server.GetMemoryStats().inverted_index },
+        { "runs"s, stats.runs },
+        { "merge_passes"s, stats.merge_passes },
+        { "index_bytes"s, stats.index_bytes },
+    };
+
+    // The disk index must rank exactly as the server built from the same documents
+    const DiskIndex disk_index(path);
+    vector<vector<Document>> results(queries.size());
+    records.push_back(Measure("DiskIndex"s, "search"s, 1, queries.size(), [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            results[i] = disk_index.FindTopDocuments(queries[i]);
+            found += results[i].size();
+        }
+        return found;
+        }));
+    size_t mismatched_queries = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = search_server.FindTopDocuments(queries[i]);
+        mismatched_queries += equal(results[i].begin(), results[i].end(), expected.begin(), expected.end(), [](const Document& lhs, const Document& rhs) {
+            return lhs.id == rhs.id && lhs.relevance == rhs.relevance;
+            }) ? 0 : 1;
+    }
+    records.back().counters = { { "mismatched_queries"s, mismatched_queries } };
+    std::remove(path.c_str());
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkAllocatorChurn(const vector<string>& documents, int rounds) {
+    vector<BenchmarkRecord> records;
+    for (const string_view variant : { "default"sv, "counted"sv, "pool"sv }) {
+        records.push_back(MeasureInChildProcess([&] {
+            // Allocations of "counted" and "pool" are counted by their own resource, which does not
+            // depend on the state of the process heap; "default" is the server without a resource
+            CountingMemoryResource counting;
+            // The benchmark removes documents sequentially, so the pool needs no locking
+            pmr::unsynchronized_pool_resource pool(&counting);
+            SearchServerOptions options;
+            if (variant != "default"sv) {
+                options.memory_resource = variant == "pool"sv ? static_cast<pmr::memory_resource*>(&pool) : &counting;
+            }
+            const size_t start_resident_bytes = GetResidentBytes();
+            size_t peak_resident_bytes = start_resident_bytes;
+            SearchServer search_server(""s, options);
+
+            size_t operations = 0;
+            BenchmarkRecord record = Measure("AllocatorChurn"s, string(variant), 1, 0, [&] {
+                int next_id = 0;
+                for (const string& document : documents) {
+                    search_server.AddDocument(next_id++, document, DocumentStatus::ACTUAL, { 1, 2, 3 });
+                }
+                operations += documents.size();
+                for (int round = 0; round < rounds; ++round) {
+                    peak_resident_bytes = max(peak_resident_bytes, GetResidentBytes());
+                    const vector<int> ids(search_server.begin(), search_server.end());
+                    for (size_t i = 0; i < ids.size(); i += 2) {
+                        search_server.RemoveDocument(ids[i]);
+                        search_server.AddDocument(next_id++, documents[i % documents.size()], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                        operations += 2;
+                    }
+                }
+                return static_cast<size_t>(search_server.GetDocumentCount());
+                });
+            peak_resident_bytes = max(peak_resident_bytes, GetResidentBytes());
+            record.operations = operations;
+            if (variant != "default"sv) {
+                record.counters = {
+                    { "allocations"s, counting.GetAllocationCount() },
+                    { "allocated_bytes"s, counting.GetAllocatedBytes() },
+                    { "peak_bytes"s, counting.GetPeakBytes() },
+                    { "final_bytes"s, counting.GetCurrentBytes() },
+                };
+            }
+            record.counters.push_back({ "rss_growth_bytes"s, peak_resident_bytes - start_resident_bytes });
+            return record;
+            }));
+    }
+    return records;
+}
+
+vector<BenchmarkRecord> BenchmarkDocumentReordering(const BenchmarkConfig& config) {
+    // Every document draws its words from the dictionary window of its topic
+    mt19937_64 generator(config.seed);
+    const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+    const int topic_count = max(1, config.document_count / 200);
+    const int topic_size = max<int>(1, 2 * dictionary.size() / topic_count);
+    auto generate_text = [&](int topic, int word_count) {
+        string text;
+        for (int i = 0; i < word_count; ++i) {
+            if (!text.empty()) {
+                text.push_back(' ');
+            }
+            const size_t rank = (static_cast<size_t>(topic) * dictionary.size() / topic_count + generator() % topic_size) % dictionary.size();
+            text += dictionary[rank];
+        }
+        return text;
+    };
+    vector<int> ids(config.document_count);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+
+    SearchServerOptions options;
+    options.quantize_impacts = true;
+    SearchServer search_server(""s, options);
+    for (const int id : ids) {
+        search_server.AddDocument(id, generate_text(static_cast<int>(generator() % topic_count), config.document_word_count), DocumentStatus::ACTUAL,
+            { 1, 2, 3 });
+    }
+    vector<string> queries;
+    for (int i = 0; i < config.query_count; ++i) {
+        queries.push_back(generate_text(static_cast<int>(generator() % topic_count), 3));
+    }
+
+    auto find_all = [&] {
+        size_t found = 0;
+        for (const string& query : queries) {
+            found += search_server.FindTopDocuments<QuantizedTfIdfScorer>(query).size();
+        }
+        return found;
+    };
+    auto set_gap_counters = [&search_server](BenchmarkRecord& record) {
+        const PostingGapStats stats = search_server.GetPostingGapStats();
+        record.counters = {
+            { "varint_bytes"s, stats.varint_bytes },
+            { "avg_gap_bits_x100"s, static_cast<size_t>(stats.average_log2_gap * 100) },
+            { "gaps_1_bit"s, stats.gap_bit_counts[1] },
+            { "gaps_over_8_bits"s, accumulate(stats.gap_bit_counts.begin() + 9, stats.gap_bit_counts.end(), size_t{ 0 }) },
+        };
+    };
+
+    vector<BenchmarkRecord> records;
+    records.push_back(Measure("DocumentReordering"s, "original"s, 1, queries.size(), find_all));
+    set_gap_counters(records.back());
+    records.push_back(Measure("DocumentReordering"s, "reorder"s, 1, static_cast<size_t>(search_server.GetDocumentCount()), [&] {
+        search_server.ReorderDocuments();
+        return static_cast<size_t>(search_server.GetDocumentCount());
+        }));
+    records.push_back(Measure("DocumentReordering"s, "reordered"s, 1, queries.size(), find_all));
+    set_gap_counters(records.back());
+    return records;
+}
+
+vector<BenchmarkRecord> RunBenchmarks(const BenchmarkConfig& config) {
+    mt19937_64 generator(config.seed);
+    const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+    const WordSampler sampler(dictionary.size(), config.zipf_exponent);
+    const auto documents = GenerateQueries(generator, dictionary, sampler, config.document_count, config.document_word_count);
+    const auto queries = GenerateQueries(generator, dictionary, sampler, config.query_count, config.query_word_count, config.minus_word_probability);
+    const string match_query = GenerateQuery(generator, dictionary, sampler, 500, config.minus_word_probability);
+    const auto short_queries = GenerateQueries(generator, dictionary, sampler, config.query_count, 3);
+    // Query log where popular words are shared by many queries whatever the corpus distribution
+    const auto skewed_queries = GenerateQueries(generator, dictionary, WordSampler(dictionary.size(), 1.0), config.query_count,
+        config.query_word_count, config.minus_word_probability);
+    const auto two_word_queries = GenerateQueries(generator, dictionary, sampler, config.query_count, MAX_TIERED_QUERY_WORDS);
+    const auto single_word_queries = GenerateQueries(generator, dictionary, WordSampler(dictionary.size(), 1.0), config.query_count, 1);
+
+    vector<BenchmarkRecord> records;
+    {
+        SearchServer search_server(dictionary[0]);
+        records.push_back(Measure("AddDocument"s, "seq"s, 1, documents.size(), [&] {
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+            return static_cast<size_t>(search_server.GetDocumentCount());
+            }));
+
+        records.push_back(Measure("FindTopDocuments"s, "seq"s, 1, queries.size(), [&] {
+            return FindAll(search_server, queries, execution::seq);
+            }));
+        records.push_back(Measure("FindTopDocuments"s, "par"s, 1, queries.size(), [&] {
+            return FindAll(search_server, queries, execution::par);
+            }));
+        for (const int thread_count : config.thread_counts) {
+            records.push_back(Measure("FindTopDocuments"s, "threads"s, thread_count, queries.size(), [&] {
+                return FindAllOnThreads(search_server, queries, thread_count);
+                }));
+        }
+        records.push_back(Measure("ProcessQueries"s, "par"s, 1, queries.size(), [&] {
+            return HashResults(ProcessQueries(search_server, queries));
+            }));
+
+        for (auto& record : BenchmarkMatchDocuments(search_server, match_query)) {
+            records.push_back(move(record));
+        }
+        for (auto& record : BenchmarkQueryModes(search_server, short_queries)) {
+            records.push_back(move(record));
+        }
+        for (auto& record : BenchmarkSharedScan(search_server, skewed_queries)) {
+            records.push_back(move(record));
+        }
+    }
+    for (auto& record : BenchmarkStopWords(dictionary, documents)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkQuantizedImpacts(documents, queries)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkTieredPostings(documents, two_word_queries)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkHotTerms(documents, single_word_queries)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkAnytimeSearch(documents, queries)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkFuzzySearch(config)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkDocumentReordering(config)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkDiskIndex(dictionary, documents, queries)) {
+        records.push_back(move(record));
+    }
+    for (auto& record : BenchmarkAllocatorChurn(documents)) {
+        records.push_back(move(record));
+    }
+    {
+        // Same documents as for AddDocument, loaded from one tab-separated buffer
+        string input;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            input += to_string(i) + "\tACTUAL\t1 2 3\t"s + documents[i] + '\n';
+        }
+        SearchServer search_server(dictionary[0]);
+        records.push_back(Measure("BulkLoad"s, "par"s, 1, documents.size(), [&] {
+            return LoadDocuments(search_server, input).documents;
+            }));
+    }
+    {
+        SearchServer search_server = BuildSearchServer(dictionary, documents);
+        records.push_back(Measure("RemoveDocument"s, "seq"s, 1, documents.size(), [&] {
+            return RemoveAll(search_server, execution::seq);
+            }));
+    }
+    {
+        SearchServer search_server = BuildSearchServer(dictionary, documents);
+        records.push_back(Measure("RemoveDocument"s, "par"s, 1, documents.size(), [&] {
+            return RemoveAll(search_server, execution::par);
+            }));
+    }
+    {
+        // Every document is added twice, RemoveDuplicates must drop a half of them
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(2 * i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            search_server.AddDocument(static_cast<int>(2 * i + 1), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        ostringstream log;
+        auto* const cout_buffer = cout.rdbuf(log.rdbuf());
+        records.push_back(Measure("RemoveDuplicates"s, "seq"s, 1, 2 * documents.size(), [&] {
+            RemoveDuplicates(search_server);
+            return static_cast<size_t>(search_server.GetDocumentCount());
+            }));
+        cout.rdbuf(cout_buffer);
+    }
+    return records;
+}
+
+void PrintBenchmarkRecords(ostream& out, const vector<BenchmarkRecord>& records) {
+    for (const auto& record : records) {
+        out << record.name << " ["sv << record.variant << ", threads = "sv << record.threads << "]: "sv
+            << chrono::duration_cast<chrono::milliseconds>(record.duration).count() << " ms, "sv
+            << (record.operations == 0 ? 0 : record.duration.count() / record.operations) << " ns/op, checksum = "sv
+            << record.checksum;
+        for (const auto& [counter, value] : record.counters) {
+            out << ", "sv << counter << " = "sv << value;
+        }
+        out << endl;
+    }
+}
+
+void PrintBenchmarkRecordsJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkRecord>& records) {
+    out << "{\"config\":{"sv
+        << "\"seed\":"sv << config.seed
+        << ",\"dictionary_size\":"sv << config.dictionary_size
+        << ",\"document_count\":"sv << config.document_count
+        << ",\"document_word_count\":"sv << config.document_word_count
+        << ",\"query_count\":"sv << config.query_count
+        << ",\"query_word_count\":"sv << config.query_word_count
+        << ",\"minus_word_probability\":"sv << config.minus_word_probability
+        << ",\"zipf_exponent\":"sv << config.zipf_exponent
+        << "},\"results\":["sv;
+    bool is_first = true;
+    for (const auto& record : records) {
+        out << (is_first ? "\n"sv : ",\n"sv) << "{\"name\":"sv;
+        PrintJsonString(out, record.name);
+        out << ",\"variant\":"sv;
+        PrintJsonString(out, record.variant);
+        out << ",\"threads\":"sv << record.threads
+            << ",\"operations\":"sv << record.operations
+            << ",\"total_ns\":"sv << record.duration.count()
+            << ",\"ns_per_op\":"sv << (record.operations == 0 ? 0 : record.duration.count() / record.operations)
+            << ",\"checksum\":"sv << record.checksum;
+        for (const auto& [counter, value] : record.counters) {
+            out << ',';
+            PrintJsonString(out, counter);
+            out << ':' << value;
+        }
+        out << '}';
+        is_first = false;
+    }
+    out << "\n]}"sv << endl;
+}
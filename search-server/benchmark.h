@@ -0,0 +1,111 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "search_server.h"
+
+using namespace std;
+
+// Synthetic workload: every generator is driven by one seeded engine,
+// so the same config produces the same corpus and queries
+struct BenchmarkConfig {
+    uint64_t seed = 42;
+    int dictionary_size = 1000;
+    int max_word_length = 10;
+    int document_count = 10'000;
+    int document_word_count = 70;
+    int query_count = 1'000;
+    int query_word_count = 10;
+    double minus_word_probability = 0.1;
+    // Exponent of the Zipf distribution of words, 0 gives uniformly distributed words
+    double zipf_exponent = 0.0;
+    vector<int> thread_counts = { 1, 2, 4, 8 };
+};
+
+struct BenchmarkRecord {
+    string name;
+    string variant;
+    int threads = 1;
+    size_t operations = 0;
+    chrono::nanoseconds duration{ 0 };
+    // Derived from the produced results, it must not change between versions for the same config.
+    // Deterministic searches fold the ids and relevances, the others count the results
+    size_t checksum = 0;
+    // Scenario specific measurements, for example allocation counts
+    vector<pair<string, size_t>> counters;
+};
+
+// Draws dictionary ranks with probability proportional to 1 / (rank + 1)^exponent
+class WordSampler {
+public:
+    WordSampler(size_t word_count, double zipf_exponent);
+    size_t operator()(mt19937_64& generator) const;
+
+private:
+    vector<double> cumulative_weights_;
+};
+
+vector<string> GenerateDictionary(mt19937_64& generator, int word_count, int max_length);
+string GenerateQuery(mt19937_64& generator, const vector<string>& dictionary, const WordSampler& sampler, int word_count, double minus_prob = 0);
+vector<string> GenerateQueries(mt19937_64& generator, const vector<string>& dictionary, const WordSampler& sampler, int query_count, int word_count,
+    double minus_prob = 0);
+
+vector<BenchmarkRecord> RunBenchmarks(const BenchmarkConfig& config);
+
+// Compares the per-document MatchDocument loop with a single batch MatchDocuments call
+vector<BenchmarkRecord> BenchmarkMatchDocuments(const SearchServer& search_server, const string& query);
+
+// Per-query ProcessQueries against the shared scans of ProcessQueriesBatched
+vector<BenchmarkRecord> BenchmarkSharedScan(const SearchServer& search_server, const vector<string>& queries);
+
+// OR semantics against QueryMode::ALL, where the intersection starts from the rarest word
+vector<BenchmarkRecord> BenchmarkQueryModes(const SearchServer& search_server, const vector<string>& queries);
+
+// Fuzzy word~1 searches over dictionaries of growing size, every dictionary word is indexed
+vector<BenchmarkRecord> BenchmarkFuzzySearch(const BenchmarkConfig& config);
+
+// Exact TF-IDF against the quantized impact index. The counters of the quantized record give
+// the compared top positions and the ones which match the exact order
+vector<BenchmarkRecord> BenchmarkQuantizedImpacts(const vector<string>& documents, const vector<string>& queries);
+
+// Exhaustive TF-IDF search against tiered_postings on queries of MAX_TIERED_QUERY_WORDS words,
+// both variants return the same documents. The counters give the size of the tiers and the number
+// of queries answered from them and of those which fell back to whole posting lists
+vector<BenchmarkRecord> BenchmarkTieredPostings(const vector<string>& documents, const vector<string>& queries);
+
+// Stop word lookups of every word of the documents: the string copy and tree search
+// SearchServer did before against its perfect hash, both variants find the same words
+vector<BenchmarkRecord> BenchmarkStopWords(const vector<string>& dictionary, const vector<string>& documents, size_t stop_word_count = 64);
+
+// Single-word queries with Zipf distributed words over a server without and with the hot
+// term cache, both variants return the same documents
+vector<BenchmarkRecord> BenchmarkHotTerms(const vector<string>& documents, const vector<string>& queries, size_t hot_term_count = 64);
+
+// Exact search against budgets in postings and in time over a server with tiered postings.
+// The counters give the number of approximate results and of the top positions matching the exact ones
+vector<BenchmarkRecord> BenchmarkAnytimeSearch(const vector<string>& documents, const vector<string>& queries);
+
+// Builds a DiskIndex with a memory limit far below the size of the index, the build counters
+// compare it with the in-memory index. The search record counts the queries ranked differently
+// from a SearchServer with the same documents, it must be zero
+vector<BenchmarkRecord> BenchmarkDiskIndex(const vector<string>& dictionary, const vector<string>& documents, const vector<string>& queries,
+    size_t memory_limit = 1 << 20);
+
+// Rounds of removing a half of the documents and adding them back under new ids: "default" without
+// a memory resource, "counted" with a counting resource over operator new and "pool" with a pool
+// over the counting resource. Every variant runs in its own child process and reports the largest
+// growth of the resident set size sampled between rounds. The counters of the resource cover the
+// nodes of the internal maps and sets, every node for "counted" and whole chunks for "pool".
+// Vectors of the server (the forward index, positions, term ids, posting tiers, the hot term cache)
+// and the document texts do not use the resource and are seen only in the resident set size
+vector<BenchmarkRecord> BenchmarkAllocatorChurn(const vector<string>& documents, int rounds = 4);
+
+// Quantized searches over a corpus of topics with shuffled ids before and after ReorderDocuments,
+// the counters describe the gaps of the impact posting lists
+vector<BenchmarkRecord> BenchmarkDocumentReordering(const BenchmarkConfig& config);
+
+void PrintBenchmarkRecords(ostream& out, const vector<BenchmarkRecord>& records);
+void PrintBenchmarkRecordsJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkRecord>& records);
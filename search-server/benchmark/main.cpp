@@ -0,0 +1,72 @@
+#include "../benchmark.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Usage: search_server_benchmark [--seed=N] [--documents=N] [--queries=N] [--dictionary=N]
+//        [--document-words=N] [--query-words=N] [--zipf=S] [--threads=1,2,4,8] [--format=json|text]
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    bool is_json = true;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            const size_t separator = argument.find('=');
+            if (argument.substr(0, 2) != "--"sv || separator == argument.npos) {
+                throw invalid_argument("Invalid argument "s + string(argument));
+            }
+            const string_view name = argument.substr(2, separator - 2);
+            const string value(argument.substr(separator + 1));
+            if (name == "seed"sv) {
+                config.seed = stoull(value);
+            }
+            else if (name == "documents"sv) {
+                config.document_count = stoi(value);
+            }
+            else if (name == "queries"sv) {
+                config.query_count = stoi(value);
+            }
+            else if (name == "dictionary"sv) {
+                config.dictionary_size = stoi(value);
+            }
+            else if (name == "document-words"sv) {
+                config.document_word_count = stoi(value);
+            }
+            else if (name == "query-words"sv) {
+                config.query_word_count = stoi(value);
+            }
+            else if (name == "zipf"sv) {
+                config.zipf_exponent = stod(value);
+            }
+            else if (name == "threads"sv) {
+                config.thread_counts.clear();
+                for (size_t begin = 0; begin <= value.size();) {
+                    const size_t end = min(value.find(',', begin), value.size());
+                    config.thread_counts.push_back(stoi(value.substr(begin, end - begin)));
+                    begin = end + 1;
+                }
+            }
+            else if (name == "format"sv) {
+                is_json = value == "json"s;
+            }
+            else {
+                throw invalid_argument("Unknown argument "s + string(argument));
+            }
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    const auto records = RunBenchmarks(config);
+    if (is_json) {
+        PrintBenchmarkRecordsJson(cout, config, records);
+    }
+    else {
+        PrintBenchmarkRecords(cout, records);
+    }
+    return 0;
+}
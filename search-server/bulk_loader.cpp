@@ -0,0 +1,222 @@
+#include "bulk_loader.h"
+
+#include <charconv>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct ParsedDocument {
+    size_t line_number = 0;
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    TokenizedDocument document;
+};
+
+struct ParsedChunk {
+    vector<ParsedDocument> documents;
+    size_t bytes = 0;
+};
+
+string_view NextField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == line.npos) {
+        throw invalid_argument("Missing field"s);
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc{} || end != text.data() + text.size()) {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    static const string_view names[] = { "ACTUAL"sv, "IRRELEVANT"sv, "BANNED"sv, "REMOVED"sv };
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (text == names[status]) {
+            return static_cast<DocumentStatus>(status);
+        }
+    }
+    int status = -1;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), status);
+    if (error != errc{} || end != text.data() + text.size() || status < 0 || status >= DOCUMENT_STATUS_COUNT) {
+        throw invalid_argument("Invalid status "s + string(text));
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+ParsedDocument ParseLine(const SearchServer& search_server, string_view line) {
+    ParsedDocument result;
+    result.id = ParseInt(NextField(line));
+    result.status = ParseStatus(NextField(line));
+    for (const auto rating : SplitIntoWords(NextField(line))) {
+        if (!rating.empty()) {
+            result.ratings.push_back(ParseInt(rating));
+        }
+    }
+    result.document = search_server.TokenizeDocument(line);
+    return result;
+}
+
+string FormatLineError(size_t line_number, const exception& e) {
+    return "Line "s + to_string(line_number) + ": "s + e.what();
+}
+
+// first_line is the number of the first line of the chunk, it is used in error messages
+ParsedChunk ParseChunk(const SearchServer& search_server, string_view chunk, size_t first_line) {
+    ParsedChunk result;
+    result.bytes = chunk.size();
+    size_t line_number = first_line;
+    while (!chunk.empty()) {
+        const size_t line_end = min(chunk.find('\n'), chunk.size());
+        string_view line = chunk.substr(0, line_end);
+        chunk.remove_prefix(min(line_end + 1, chunk.size()));
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            try {
+                result.documents.push_back(ParseLine(search_server, line));
+                result.documents.back().line_number = line_number;
+            }
+            catch (const invalid_argument& e) {
+                throw invalid_argument(FormatLineError(line_number, e));
+            }
+        }
+        ++line_number;
+    }
+    return result;
+}
+
+// Input file contents, unmapped or freed on destruction
+class FileContents {
+public:
+    explicit FileContents(const string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw runtime_error("Cannot open "s + path);
+        }
+        struct stat file_stat {};
+        if (fstat(file, &file_stat) != 0) {
+            close(file);
+            throw runtime_error("Cannot read "s + path);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data == MAP_FAILED) {
+                close(file);
+                throw runtime_error("Cannot map "s + path);
+            }
+            madvise(data, size_, MADV_SEQUENTIAL);
+            mapped_ = static_cast<const char*>(data);
+        }
+        close(file);
+#else
+        ifstream file(path, ios::binary);
+        if (!file) {
+            throw runtime_error("Cannot open "s + path);
+        }
+        buffer_.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        size_ = buffer_.size();
+#endif
+    }
+
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+
+    ~FileContents() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped_ != nullptr) {
+            munmap(const_cast<char*>(mapped_), size_);
+        }
+#endif
+    }
+
+    string_view GetText() const {
+        return mapped_ != nullptr ? string_view(mapped_, size_) : string_view(buffer_);
+    }
+
+private:
+    const char* mapped_ = nullptr;
+    string buffer_;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+BulkLoadProgress LoadDocuments(SearchServer& search_server, string_view input, const BulkLoadOptions& options) {
+    const auto start = Clock::now();
+    BulkLoadProgress progress;
+    progress.total_bytes = input.size();
+
+    // Parsing tasks only read the server, so they run while the main thread adds
+    // the documents of earlier chunks
+    deque<future<ParsedChunk>> chunks;
+    size_t next_line = 1;
+    auto start_next_chunk = [&] {
+        size_t chunk_end = min(options.chunk_size, input.size());
+        chunk_end = min(input.find('\n', chunk_end), input.size());
+        chunk_end = min(chunk_end + 1, input.size());
+        const string_view chunk = input.substr(0, chunk_end);
+        input.remove_prefix(chunk_end);
+        const size_t first_line = next_line;
+        next_line += count(chunk.begin(), chunk.end(), '\n');
+        chunks.push_back(async(launch::async, ParseChunk, cref(search_server), chunk, first_line));
+    };
+
+    while (!input.empty() && chunks.size() < max<size_t>(options.max_chunks_in_flight, 1)) {
+        start_next_chunk();
+    }
+    while (!chunks.empty()) {
+        const ParsedChunk chunk = chunks.front().get();
+        chunks.pop_front();
+        if (!input.empty()) {
+            start_next_chunk();
+        }
+
+        for (const auto& document : chunk.documents) {
+            try {
+                search_server.AddDocument(document.id, document.document, document.status, document.ratings);
+            }
+            catch (const invalid_argument& e) {
+                throw invalid_argument(FormatLineError(document.line_number, e));
+            }
+        }
+        progress.documents += chunk.documents.size();
+        progress.bytes += chunk.bytes;
+        progress.elapsed = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start);
+        progress.documents_per_second = progress.elapsed.count() > 0 ? progress.documents * 1e9 / progress.elapsed.count() : 0.0;
+        if (options.on_progress) {
+            options.on_progress(progress);
+        }
+    }
+    return progress;
+}
+
+BulkLoadProgress LoadDocumentsFromFile(SearchServer& search_server, const string& path, const BulkLoadOptions& options) {
+    const FileContents contents(path);
+    return LoadDocuments(search_server, contents.GetText(), options);
+}
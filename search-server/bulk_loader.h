@@ -0,0 +1,31 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "search_server.h"
+
+struct BulkLoadProgress {
+    size_t documents = 0;
+    size_t bytes = 0;
+    size_t total_bytes = 0;
+    chrono::nanoseconds elapsed{ 0 };
+    double documents_per_second = 0.0;
+};
+
+struct BulkLoadOptions {
+    size_t chunk_size = 1 << 20;      // Bytes parsed by one task, chunks end at line breaks
+    size_t max_chunks_in_flight = 8;  // Chunks parsed ahead of the indexing
+    function<void(const BulkLoadProgress&)> on_progress;  // Called after every indexed chunk
+};
+
+// Input holds one document per line: id<TAB>status<TAB>ratings<TAB>text, where status is
+// ACTUAL, IRRELEVANT, BANNED, REMOVED or its number and ratings are separated by spaces.
+// Chunks are parsed and tokenized in parallel while the previous ones are added to the
+// server in input order. The text of a document is copied only into the server.
+// Throws invalid_argument with the line number for a malformed line and for a document
+// rejected by AddDocument; the documents of the lines before it stay in the server.
+BulkLoadProgress LoadDocuments(SearchServer& search_server, string_view input, const BulkLoadOptions& options = {});
+
+// The file is memory mapped on POSIX systems and read into memory elsewhere
+BulkLoadProgress LoadDocumentsFromFile(SearchServer& search_server, const string& path, const BulkLoadOptions& options = {});
@@ -0,0 +1,446 @@
+#include "disk_index.h"
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+using namespace std;
+
+// File layout, integers in the native byte order:
+//   magic, version
+//   stop word count, stop words as (size, bytes)
+//   document count, documents as (id, rating, status) ordered by id
+//   words up to the end of the file as (size, bytes, posting count, postings as (id, term_freq))
+// Runs hold only the word records
+
+namespace {
+
+const uint32_t INDEX_MAGIC = 0x49445353; // "SSDI"
+const uint32_t INDEX_VERSION = 1;
+const size_t POSTING_RECORD_BYTES = sizeof(int32_t) + sizeof(double);
+const size_t MAX_MERGE_FAN_IN = 64; // runs open at once, more runs are merged in several passes
+// Tree node of a run word without the characters of a long word
+const size_t RUN_NODE_BYTES = sizeof(pair<const string, vector<pair<int, double>>>) + 4 * sizeof(void*);
+
+template <typename T>
+void WriteValue(ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadValue(istream& in) {
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    if (!in) {
+        throw runtime_error("Unexpected end of the index file"s);
+    }
+    return value;
+}
+
+void WriteString(ostream& out, string_view text) {
+    WriteValue(out, static_cast<uint32_t>(text.size()));
+    out.write(text.data(), text.size());
+}
+
+// max_size bounds the size read from a damaged file before the string is allocated
+string ReadString(istream& in, uint64_t max_size = numeric_limits<uint32_t>::max()) {
+    const uint32_t size = ReadValue<uint32_t>(in);
+    if (size > max_size) {
+        throw runtime_error("Unexpected end of the index file"s);
+    }
+    string text(size, '\0');
+    in.read(text.data(), text.size());
+    if (!in) {
+        throw runtime_error("Unexpected end of the index file"s);
+    }
+    return text;
+}
+
+void WritePosting(ostream& out, const pair<int, double>& posting) {
+    WriteValue(out, static_cast<int32_t>(posting.first));
+    WriteValue(out, posting.second);
+}
+
+pair<int, double> ReadPosting(istream& in) {
+    const int document_id = ReadValue<int32_t>(in);
+    return { document_id, ReadValue<double>(in) };
+}
+
+int ComputeAverageRating(const vector<int>& ratings) {
+    if (ratings.empty()) {
+        return 0;
+    }
+    return accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
+}
+
+// Same order as SearchServer::IsRankedBefore
+bool IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// Sequential reader of a spilled run: the current word, the number of its postings
+// left and the current posting
+class RunReader {
+public:
+    explicit RunReader(const string& path)
+        : file_(path, ios::binary) {
+        if (!file_) {
+            throw runtime_error("Cannot open "s + path);
+        }
+        NextWord();
+    }
+
+    bool IsDone() const {
+        return is_done_;
+    }
+
+    const string& GetWord() const {
+        return word_;
+    }
+
+    uint32_t GetPostingsLeft() const {
+        return postings_left_;
+    }
+
+    const pair<int, double>& GetPosting() const {
+        return posting_;
+    }
+
+    // Moves to the next posting, after the last posting of a word to the next word
+    void Advance() {
+        if (--postings_left_ > 0) {
+            posting_ = ReadPosting(file_);
+        }
+        else {
+            NextWord();
+        }
+    }
+
+private:
+    ifstream file_;
+    string word_;
+    uint32_t postings_left_ = 0;
+    pair<int, double> posting_;
+    bool is_done_ = false;
+
+    void NextWord() {
+        if (file_.peek() == ifstream::traits_type::eof()) {
+            is_done_ = true;
+            return;
+        }
+        word_ = ReadString(file_);
+        postings_left_ = ReadValue<uint32_t>(file_);
+        posting_ = ReadPosting(file_);
+    }
+};
+
+// Merges the runs into out in the run format and returns the number of words.
+// Every run is ordered by word, so all runs holding the smallest word are at it at once.
+// Their postings are merged by id, a document is in one run only
+size_t MergeRuns(const vector<string>& paths, ostream& out) {
+    vector<RunReader> runs;
+    runs.reserve(paths.size());
+    for (const string& path : paths) {
+        runs.emplace_back(path);
+    }
+    size_t word_count = 0;
+    vector<RunReader*> word_runs;
+    while (true) {
+        const string* word = nullptr;
+        for (const RunReader& run : runs) {
+            if (!run.IsDone() && (word == nullptr || run.GetWord() < *word)) {
+                word = &run.GetWord();
+            }
+        }
+        if (word == nullptr) {
+            break;
+        }
+
+        word_runs.clear();
+        uint32_t posting_count = 0;
+        for (RunReader& run : runs) {
+            if (!run.IsDone() && run.GetWord() == *word) {
+                word_runs.push_back(&run);
+                posting_count += run.GetPostingsLeft();
+            }
+        }
+        WriteString(out, *word);
+        WriteValue(out, posting_count);
+        // The word is copied since advancing the run that holds it replaces it
+        const string current_word = *word;
+        while (!word_runs.empty()) {
+            const auto first = min_element(word_runs.begin(), word_runs.end(), [](const RunReader* lhs, const RunReader* rhs) {
+                return lhs->GetPosting().first < rhs->GetPosting().first;
+                });
+            WritePosting(out, (*first)->GetPosting());
+            (*first)->Advance();
+            if ((*first)->IsDone() || (*first)->GetWord() != current_word) {
+                word_runs.erase(first);
+            }
+        }
+        ++word_count;
+    }
+    return word_count;
+}
+
+} // namespace
+
+DiskIndexBuilder::DiskIndexBuilder(const string& path, string_view stop_words, const DiskIndexBuildOptions& options)
+    : path_(path)
+    , options_(options)
+    , tokenizer_(stop_words) {
+    for (const string& stop_word : MakeUniqueNonEmptyStrings(SplitIntoWords(stop_words))) {
+        stop_words_.insert(stop_word);
+    }
+}
+
+DiskIndexBuilder::~DiskIndexBuilder() {
+    RemoveRuns();
+}
+
+void DiskIndexBuilder::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (is_finished_) {
+        throw logic_error("The index is already finished"s);
+    }
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+
+    // Term frequencies are summed the same way as in SearchServer, so they are equal to the last bit
+    auto words = tokenizer_.TokenizeDocument(document).words;
+    const double inv_word_count = 1.0 / words.size();
+    sort(words.begin(), words.end());
+    for (auto it = words.begin(); it != words.end();) {
+        const string_view word = *it;
+        double term_freq = 0.0;
+        for (; it != words.end() && *it == word; ++it) {
+            term_freq += inv_word_count;
+        }
+
+        auto postings = run_.find(word);
+        if (postings == run_.end()) {
+            postings = run_.emplace(string(word), vector<pair<int, double>>{}).first;
+            run_bytes_ += RUN_NODE_BYTES + (word.size() >= sizeof(string) ? word.size() + 1 : 0);
+        }
+        const size_t capacity = postings->second.capacity();
+        postings->second.push_back({ document_id, term_freq });
+        run_bytes_ += (postings->second.capacity() - capacity) * sizeof(pair<int, double>);
+        ++stats_.postings;
+    }
+    documents_[document_id] = { ComputeAverageRating(ratings), status };
+    ++stats_.documents;
+
+    if (run_bytes_ >= options_.memory_limit) {
+        SpillRun();
+    }
+}
+
+string DiskIndexBuilder::AddRunPath() {
+    run_paths_.push_back(path_ + ".run"s + to_string(run_number_++));
+    return run_paths_.back();
+}
+
+void DiskIndexBuilder::SpillRun() {
+    const string path = AddRunPath();
+    ofstream out(path, ios::binary);
+    for (auto& [word, postings] : run_) {
+        sort(postings.begin(), postings.end());
+        WriteString(out, word);
+        WriteValue(out, static_cast<uint32_t>(postings.size()));
+        for (const auto& posting : postings) {
+            WritePosting(out, posting);
+        }
+    }
+    out.close();
+    if (!out) {
+        throw runtime_error("Cannot write "s + path);
+    }
+
+    stats_.peak_run_bytes = max(stats_.peak_run_bytes, run_bytes_);
+    ++stats_.runs;
+    run_.clear();
+    run_bytes_ = 0;
+}
+
+DiskIndexBuildStats DiskIndexBuilder::Finish() {
+    if (is_finished_) {
+        throw logic_error("The index is already finished"s);
+    }
+    is_finished_ = true;
+    if (!run_.empty()) {
+        SpillRun();
+    }
+    while (run_paths_.size() > MAX_MERGE_FAN_IN) {
+        const vector<string> merged_paths(run_paths_.begin(), run_paths_.begin() + MAX_MERGE_FAN_IN);
+        const string path = AddRunPath();
+        ofstream run(path, ios::binary);
+        MergeRuns(merged_paths, run);
+        run.close();
+        if (!run) {
+            throw runtime_error("Cannot write "s + path);
+        }
+        for (const string& merged_path : merged_paths) {
+            std::remove(merged_path.c_str());
+        }
+        run_paths_.erase(run_paths_.begin(), run_paths_.begin() + MAX_MERGE_FAN_IN);
+        ++stats_.merge_passes;
+    }
+
+    ofstream out(path_, ios::binary);
+    WriteValue(out, INDEX_MAGIC);
+    WriteValue(out, INDEX_VERSION);
+    WriteValue(out, static_cast<uint32_t>(stop_words_.size()));
+    for (const string& stop_word : stop_words_) {
+        WriteString(out, stop_word);
+    }
+    WriteValue(out, static_cast<uint64_t>(documents_.size()));
+    for (const auto& [document_id, document_data] : documents_) {
+        WriteValue(out, static_cast<int32_t>(document_id));
+        WriteValue(out, static_cast<int32_t>(document_data.rating));
+        WriteValue(out, static_cast<int32_t>(document_data.status));
+    }
+    documents_.clear();
+
+    stats_.words = MergeRuns(run_paths_, out);
+
+    stats_.index_bytes = static_cast<size_t>(out.tellp());
+    out.close();
+    if (!out) {
+        throw runtime_error("Cannot write "s + path_);
+    }
+    RemoveRuns();
+    return stats_;
+}
+
+void DiskIndexBuilder::RemoveRuns() {
+    for (const string& path : run_paths_) {
+        std::remove(path.c_str());
+    }
+    run_paths_.clear();
+}
+
+DiskIndex::DiskIndex(const string& path)
+    : path_(path) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    // Sizes read from a damaged file are checked against the bytes left before they are used
+    const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    auto bytes_left = [&file, file_size] {
+        return file_size - static_cast<uint64_t>(file.tellg());
+    };
+    if (ReadValue<uint32_t>(file) != INDEX_MAGIC || ReadValue<uint32_t>(file) != INDEX_VERSION) {
+        throw runtime_error("Not a search index "s + path);
+    }
+    for (uint32_t i = ReadValue<uint32_t>(file); i > 0; --i) {
+        stop_words_.insert(ReadString(file, bytes_left()));
+    }
+    for (uint64_t i = ReadValue<uint64_t>(file); i > 0; --i) {
+        const int document_id = ReadValue<int32_t>(file);
+        const int rating = ReadValue<int32_t>(file);
+        const int status = ReadValue<int32_t>(file);
+        if (status < 0 || status >= DOCUMENT_STATUS_COUNT || documents_.count(document_id) > 0) {
+            throw runtime_error("Damaged document record in "s + path);
+        }
+        documents_.emplace_hint(documents_.end(), document_id, DocumentData{ rating, static_cast<DocumentStatus>(status) });
+    }
+    // Only the dictionary is read, the posting lists are skipped
+    while (file.peek() != ifstream::traits_type::eof()) {
+        string word = ReadString(file, bytes_left());
+        WordEntry entry;
+        entry.posting_count = ReadValue<uint32_t>(file);
+        entry.offset = static_cast<uint64_t>(file.tellg());
+        if (entry.posting_count > bytes_left() / POSTING_RECORD_BYTES) {
+            throw runtime_error("Unexpected end of the index file"s);
+        }
+        file.seekg(entry.posting_count * POSTING_RECORD_BYTES, ios::cur);
+        words_.emplace_hint(words_.end(), move(word), entry);
+    }
+}
+
+int DiskIndex::GetDocumentCount() const {
+    return static_cast<int>(documents_.size());
+}
+
+size_t DiskIndex::GetWordCount() const {
+    return words_.size();
+}
+
+vector<pair<int, double>> DiskIndex::GetPostings(string_view word) const {
+    const auto entry = words_.find(word);
+    if (entry == words_.end()) {
+        return {};
+    }
+    ifstream file(path_, ios::binary);
+    return ReadPostings(file, entry->second);
+}
+
+vector<pair<int, double>> DiskIndex::ReadPostings(istream& file, const WordEntry& entry) const {
+    file.seekg(entry.offset);
+    vector<pair<int, double>> postings(entry.posting_count);
+    for (auto& posting : postings) {
+        posting = ReadPosting(file);
+    }
+    return postings;
+}
+
+vector<Document> DiskIndex::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    vector<string_view> plus_words;
+    vector<string_view> minus_words;
+    for (auto word : SplitIntoWords(raw_query)) {
+        const bool is_minus = !word.empty() && word[0] == '-';
+        if (is_minus) {
+            word.remove_prefix(1);
+        }
+        if (word.empty() || word[0] == '-' || any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+            throw invalid_argument("Invalid query word "s + string(word));
+        }
+        if (stop_words_.count(word) == 0) {
+            (is_minus ? minus_words : plus_words).push_back(word);
+        }
+    }
+    sort(plus_words.begin(), plus_words.end());
+    plus_words.erase(unique(plus_words.begin(), plus_words.end()), plus_words.end());
+
+    // Words are added in their sorted order as in SearchServer, so the sums are the same
+    ifstream file(path_, ios::binary);
+    const TfIdfScorer scorer;
+    const CorpusStats corpus_stats{ documents_.size(), 0.0 };
+    map<int, double> document_to_relevance;
+    for (const auto word : plus_words) {
+        const auto entry = words_.find(word);
+        if (entry == words_.end()) {
+            continue;
+        }
+        const auto word_scorer = scorer.ForWord(corpus_stats, entry->second.posting_count);
+        for (const auto& [document_id, term_freq] : ReadPostings(file, entry->second)) {
+            if (documents_.at(document_id).status == status) {
+                document_to_relevance[document_id] += word_scorer(term_freq, 0);
+            }
+        }
+    }
+    for (const auto word : minus_words) {
+        if (const auto entry = words_.find(word); entry != words_.end()) {
+            for (const auto& [document_id, _] : ReadPostings(file, entry->second)) {
+                document_to_relevance.erase(document_id);
+            }
+        }
+    }
+
+    vector<Document> matched_documents;
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    const size_t top_count = min(matched_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    partial_sort(matched_documents.begin(), matched_documents.begin() + top_count, matched_documents.end(), IsRankedBefore);
+    matched_documents.resize(top_count);
+    return matched_documents;
+}
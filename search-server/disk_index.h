@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+
+struct DiskIndexBuildOptions {
+    // Bytes of postings held in memory, a full run is sorted and spilled to the disk
+    size_t memory_limit = 64 << 20;
+};
+
+struct DiskIndexBuildStats {
+    size_t documents = 0;
+    size_t words = 0;
+    size_t postings = 0;
+    size_t runs = 0;
+    size_t merge_passes = 0;  // Merges of groups of runs into longer runs before the final merge
+    size_t peak_run_bytes = 0;  // Largest memory estimate of a run before it was spilled
+    size_t index_bytes = 0;
+};
+
+// Builds a posting file for corpora whose index does not fit in memory. Documents are inverted
+// into runs of about memory_limit bytes, every run is written to path.runN ordered by word
+// and document id, and Finish merges all runs into path and removes them.
+// Only the postings are bounded, the ids, ratings and statuses of the documents stay in memory until Finish.
+class DiskIndexBuilder {
+public:
+    DiskIndexBuilder(const string& path, string_view stop_words, const DiskIndexBuildOptions& options = {});
+    DiskIndexBuilder(const DiskIndexBuilder&) = delete;
+    DiskIndexBuilder& operator=(const DiskIndexBuilder&) = delete;
+    ~DiskIndexBuilder();
+
+    // Words are split and validated as in SearchServer::AddDocument
+    void AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings);
+    DiskIndexBuildStats Finish();
+
+private:
+    struct DocumentData {
+        int rating = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+    };
+
+    string path_;
+    DiskIndexBuildOptions options_;
+    SearchServer tokenizer_;
+    set<string, less<>> stop_words_;
+    map<int, DocumentData> documents_;
+    map<string, vector<pair<int, double>>, less<>> run_;
+    size_t run_bytes_ = 0;
+    vector<string> run_paths_;
+    size_t run_number_ = 0;
+    DiskIndexBuildStats stats_;
+    bool is_finished_ = false;
+
+    string AddRunPath();
+    void SpillRun();
+    void RemoveRuns();
+};
+
+// Index written by DiskIndexBuilder. The documents and the dictionary are loaded,
+// posting lists are read from the file for every query
+class DiskIndex {
+public:
+    // Throws runtime_error for a file which is not an index, is truncated or damaged
+    explicit DiskIndex(const string& path);
+
+    int GetDocumentCount() const;
+    size_t GetWordCount() const;
+    // Postings of the word ordered by document id
+    vector<pair<int, double>> GetPostings(string_view word) const;
+    // TF-IDF ranking of plain and -minus words, the same as SearchServer::FindTopDocuments gives
+    // for the same documents. Other query syntax is not supported, such words are taken literally
+    vector<Document> FindTopDocuments(string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+private:
+    struct DocumentData {
+        int rating = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+    };
+    struct WordEntry {
+        uint64_t offset = 0;
+        uint32_t posting_count = 0;
+    };
+
+    string path_;
+    set<string, less<>> stop_words_;
+    map<int, DocumentData> documents_;
+    map<string, WordEntry, less<>> words_;
+
+    vector<pair<int, double>> ReadPostings(istream& file, const WordEntry& entry) const;
+};
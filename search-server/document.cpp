@@ -1,5 +1,9 @@
 #include "document.h"
 
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
 ostream& operator<<(ostream& out, const Document& document) {
     out << "{ "s
         << "document_id = "s << document.id << ", "s
@@ -25,3 +29,32 @@ void PrintMatchDocumentResult(int document_id, const vector<string_view>& words,
     }
     cout << "}"s << endl;
 }
+
+string EncodeCursor(const SearchCursor& cursor) {
+    // Hexadecimal floating point keeps the relevance exact
+    ostringstream out;
+    out << hexfloat << cursor.relevance << ':' << cursor.rating << ':' << cursor.id;
+    return out.str();
+}
+
+SearchCursor DecodeCursor(string_view text) {
+    const string data(text);
+    const char* begin = data.c_str();
+    char* end = nullptr;
+    SearchCursor cursor;
+    cursor.relevance = strtod(begin, &end);
+    if (end == begin || *end != ':') {
+        throw invalid_argument("Invalid search cursor "s + data);
+    }
+    begin = end + 1;
+    cursor.rating = static_cast<int>(strtol(begin, &end, 10));
+    if (end == begin || *end != ':') {
+        throw invalid_argument("Invalid search cursor "s + data);
+    }
+    begin = end + 1;
+    cursor.id = static_cast<int>(strtol(begin, &end, 10));
+    if (end == begin || *end != '\0') {
+        throw invalid_argument("Invalid search cursor "s + data);
+    }
+    return cursor;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 using namespace std;
@@ -18,13 +20,33 @@ struct Document {
     int rating = 0;
 };
 
+// Ranking key of the last document of a page. The next page starts right after it.
+struct SearchCursor {
+    SearchCursor() = default;
+
+    explicit SearchCursor(const Document& document)
+        : relevance(document.relevance)
+        , rating(document.rating)
+        , id(document.id) {
+    }
+
+    double relevance = 0.0;
+    int rating = 0;
+    int id = 0;
+};
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
     BANNED,
     REMOVED,
 };
+const int DOCUMENT_STATUS_COUNT = 4;
 
 ostream& operator<<(ostream& out, const Document& document);
 void PrintDocument(const Document& document);
 void PrintMatchDocumentResult(int document_id, const vector<string_view>& words, DocumentStatus status);
+
+// Opaque text form of a cursor which can be passed to a client and back
+string EncodeCursor(const SearchCursor& cursor);
+SearchCursor DecodeCursor(string_view text);
@@ -0,0 +1,103 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include "document.h"
+
+using namespace std;
+
+// Filter which FindTopDocuments can analyze instead of calling an opaque predicate:
+// the id range skips postings, the rating range uses the rating index and the statuses
+// are a bit mask. All conditions must hold. An arbitrary predicate can be added
+// as a fallback, it is checked last.
+class DocumentFilter {
+public:
+    DocumentFilter() = default;
+
+    // Both bounds are inclusive
+    DocumentFilter& SetRatingRange(int min_rating, int max_rating) {
+        min_rating_ = min_rating;
+        max_rating_ = max_rating;
+        return *this;
+    }
+
+    DocumentFilter& SetIdRange(int min_id, int max_id) {
+        min_id_ = min_id;
+        max_id_ = max_id;
+        return *this;
+    }
+
+    DocumentFilter& SetStatuses(initializer_list<DocumentStatus> statuses) {
+        status_mask_ = 0;
+        for (const DocumentStatus status : statuses) {
+            status_mask_ |= GetStatusBit(status);
+        }
+        return *this;
+    }
+
+    DocumentFilter& SetPredicate(function<bool(int, DocumentStatus, int)> predicate) {
+        predicate_ = move(predicate);
+        return *this;
+    }
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const {
+        return document_id >= min_id_ && document_id <= max_id_
+            && (status_mask_ & GetStatusBit(status)) != 0
+            && rating >= min_rating_ && rating <= max_rating_
+            && (!predicate_ || predicate_(document_id, status, rating));
+    }
+
+    bool HasRatingRange() const {
+        return min_rating_ != INT_MIN || max_rating_ != INT_MAX;
+    }
+
+    int GetMinRating() const {
+        return min_rating_;
+    }
+
+    int GetMaxRating() const {
+        return max_rating_;
+    }
+
+    int GetMinId() const {
+        return min_id_;
+    }
+
+    int GetMaxId() const {
+        return max_id_;
+    }
+
+    bool HasIdRange() const {
+        return min_id_ != INT_MIN || max_id_ != INT_MAX;
+    }
+
+    bool HasPredicate() const {
+        return static_cast<bool>(predicate_);
+    }
+
+    // The only allowed status, if there is exactly one
+    optional<DocumentStatus> GetSingleStatus() const {
+        if (status_mask_ == 0 || (status_mask_ & (status_mask_ - 1)) != 0) {
+            return nullopt;
+        }
+        int status = 0;
+        while ((status_mask_ >> status) != 1) {
+            ++status;
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+private:
+    static uint8_t GetStatusBit(DocumentStatus status) {
+        return static_cast<uint8_t>(1u << static_cast<int>(status));
+    }
+
+    int min_rating_ = INT_MIN;
+    int max_rating_ = INT_MAX;
+    int min_id_ = INT_MIN;
+    int max_id_ = INT_MAX;
+    uint8_t status_mask_ = (1u << DOCUMENT_STATUS_COUNT) - 1;
+    function<bool(int, DocumentStatus, int)> predicate_;
+};
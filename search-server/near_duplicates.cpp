@@ -0,0 +1,182 @@
+#include "near_duplicates.h"
+
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+uint64_t MixHash(uint64_t x) {
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Picks bands * rows <= hash_count so that the LSH threshold (1/b)^(1/r)
+// is as close as possible to the requested Jaccard threshold
+pair<int, int> ChooseBands(int hash_count, double threshold) {
+    pair<int, int> best = { hash_count, 1 };
+    double best_error = numeric_limits<double>::max();
+    for (int bands = 1; bands <= hash_count; ++bands) {
+        const int rows = hash_count / bands;
+        const double error = abs(pow(1.0 / bands, 1.0 / rows) - threshold);
+        if (error < best_error) {
+            best_error = error;
+            best = { bands, rows };
+        }
+    }
+    return best;
+}
+
+double ComputeJaccard(const vector<string_view>& lhs, const vector<string_view>& rhs) {
+    size_t common = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (*lhs_it < *rhs_it) {
+            ++lhs_it;
+        }
+        else if (*rhs_it < *lhs_it) {
+            ++rhs_it;
+        }
+        else {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(common) / (lhs.size() + rhs.size() - common);
+}
+
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size)
+        : parents_(size) {
+        iota(parents_.begin(), parents_.end(), 0);
+    }
+
+    size_t Find(size_t x) {
+        while (parents_[x] != x) {
+            parents_[x] = parents_[parents_[x]];
+            x = parents_[x];
+        }
+        return x;
+    }
+
+    void Unite(size_t lhs, size_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        // Smaller index becomes the root, so it is the smallest document id
+        if (lhs < rhs) {
+            parents_[rhs] = lhs;
+        }
+        else {
+            parents_[lhs] = rhs;
+        }
+    }
+
+private:
+    vector<size_t> parents_;
+};
+
+} // namespace
+
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options, NearDuplicateStats* stats) {
+    if (options.hash_count <= 0 || options.jaccard_threshold <= 0.0 || options.jaccard_threshold > 1.0) {
+        throw invalid_argument("Invalid near-duplicate options"s);
+    }
+    const auto [bands, rows] = ChooseBands(options.hash_count, options.jaccard_threshold);
+
+    vector<uint64_t> hash_seeds(options.hash_count);
+    for (int i = 0; i < options.hash_count; ++i) {
+        hash_seeds[i] = MixHash(options.seed + i);
+    }
+
+    // Document ids are iterated in ascending order
+    vector<int> ids;
+    vector<vector<string_view>> words;
+    vector<vector<uint64_t>> signatures;
+    for (const int document_id : search_server) {
+        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+        if (word_freqs.empty()) {
+            continue;
+        }
+        vector<string_view> document_words;
+        vector<uint64_t> signature(options.hash_count, numeric_limits<uint64_t>::max());
+        for (const auto [word, freq] : word_freqs) {
+            document_words.push_back(word);
+            const uint64_t word_hash = hash<string_view>{}(word);
+            for (int i = 0; i < options.hash_count; ++i) {
+                signature[i] = min(signature[i], MixHash(word_hash ^ hash_seeds[i]));
+            }
+        }
+        sort(document_words.begin(), document_words.end());
+        ids.push_back(document_id);
+        words.push_back(move(document_words));
+        signatures.push_back(move(signature));
+    }
+
+    DisjointSets clusters(ids.size());
+    NearDuplicateStats local_stats;
+    for (int band = 0; band < bands; ++band) {
+        unordered_map<uint64_t, vector<size_t>> buckets;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            uint64_t band_hash = MixHash(band);
+            for (int row = 0; row < rows; ++row) {
+                band_hash = MixHash(band_hash ^ signatures[i][band * rows + row]);
+            }
+            buckets[band_hash].push_back(i);
+        }
+        // Every member is compared with one representative of each cluster met in the bucket,
+        // members already in the cluster of a representative are not compared with it. Union-find
+        // merges clusters transitively, so a bucket of similar documents costs one comparison per member
+        for (const auto& [band_hash, members] : buckets) {
+            vector<size_t> representatives;
+            for (const size_t member : members) {
+                bool is_clustered = false;
+                for (const size_t representative : representatives) {
+                    if (clusters.Find(representative) == clusters.Find(member)) {
+                        is_clustered = true;
+                        continue;
+                    }
+                    ++local_stats.jaccard_computations;
+                    if (ComputeJaccard(words[representative], words[member]) >= options.jaccard_threshold) {
+                        clusters.Unite(representative, member);
+                        is_clustered = true;
+                    }
+                }
+                if (!is_clustered) {
+                    representatives.push_back(member);
+                }
+            }
+        }
+    }
+    if (stats) {
+        *stats = local_stats;
+    }
+
+    map<size_t, vector<int>> root_to_cluster;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        root_to_cluster[clusters.Find(i)].push_back(ids[i]);
+    }
+    vector<vector<int>> result;
+    for (auto& [root, cluster] : root_to_cluster) {
+        if (cluster.size() > 1) {
+            result.push_back(move(cluster));
+        }
+    }
+    return result;
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options) {
+    for (const auto& cluster : FindNearDuplicates(search_server, options)) {
+        for (auto id = next(cluster.begin()); id != cluster.end(); ++id) {
+            cout << "Found near-duplicate document id "s << *id << " of "s << cluster.front() << endl;
+            search_server.RemoveDocument(*id);
+        }
+    }
+}
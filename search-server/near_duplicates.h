@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "search_server.h"
+
+struct NearDuplicateOptions {
+    double jaccard_threshold = 0.8;  // Minimal Jaccard similarity of word sets
+    int hash_count = 128;            // MinHash signature length
+    uint64_t seed = 0;
+};
+
+struct NearDuplicateStats {
+    size_t jaccard_computations = 0;  // Exact Jaccard indexes computed for candidate pairs
+};
+
+// Groups documents whose word sets are similar according to MinHash signatures
+// split into LSH bands. A document sharing a bucket is confirmed with the exact Jaccard index
+// against one document of every other cluster in the bucket.
+// Each cluster is sorted by id, clusters are ordered by their first id.
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options = {},
+    NearDuplicateStats* stats = nullptr);
+
+// Keeps the document with the smallest id in every cluster and removes the rest
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options = {});
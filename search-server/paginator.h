@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 using namespace std;
@@ -38,34 +40,87 @@ ostream& operator<<(ostream& out, const IteratorRange<Iterator>& range) {
     return out;
 }
 
+// Moves the iterator forward by at most count steps without passing end
+template <typename Iterator>
+Iterator AdvanceAtMost(Iterator it, Iterator end, size_t count) {
+    for (; count > 0 && it != end; --count) {
+        ++it;
+    }
+    return it;
+}
+
+// Pages are built on the fly while iterating, nothing is materialized up front
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_.push_back({ begin, current_page_end });
-
-            left -= current_page_size;
-            begin = current_page_end;
+    class PageIterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        PageIterator(Iterator page_begin, Iterator end, size_t page_size)
+            : page_begin_(page_begin)
+            , page_end_(AdvanceAtMost(page_begin, end, page_size))
+            , end_(end)
+            , page_size_(page_size) {
         }
+
+        IteratorRange<Iterator> operator*() const {
+            return { page_begin_, page_end_ };
+        }
+
+        PageIterator& operator++() {
+            page_begin_ = page_end_;
+            page_end_ = AdvanceAtMost(page_begin_, end_, page_size_);
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return page_begin_ == other.page_begin_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return page_begin_ != other.page_begin_;
+        }
+
+    private:
+        Iterator page_begin_, page_end_, end_;
+        size_t page_size_;
+    };
+
+    // Throws invalid_argument for an empty page size
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(page_size > 0 ? page_size : throw invalid_argument("Page size must be positive"s))
+        , size_((distance(begin, end) + page_size_ - 1) / page_size_) {
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return { begin_, end_, page_size_ };
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return { end_, end_, page_size_ };
     }
 
     size_t size() const {
-        return pages_.size();
+        return size_;
     }
 
 private:
-    vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_, end_;
+    size_t page_size_;
+    size_t size_;
 };
 
 template <typename Container>
@@ -6,10 +6,20 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 {
     vector<std::vector<Document>> result(queries.size());
     transform(execution::par, queries.begin(), queries.end(), result.begin(),
-        [&search_server](string query) {return search_server.FindTopDocuments(query); });
+        [&search_server](string query) {
+            SEARCH_STAGE(SearchStage::QUERY);
+            SEARCH_COUNT(SearchCounter::QUERIES_PROCESSED, 1);
+            return search_server.FindTopDocuments(query);
+        });
     return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server, const std::vector<std::string>& queries)
+{
+    SEARCH_COUNT(SearchCounter::QUERIES_PROCESSED, queries.size());
+    return search_server.FindTopDocumentsBatch(execution::par, queries);
+}
+
 std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
 {
     vector<std::vector<Document>> result_find_documents(queries.size());
@@ -1,32 +1,57 @@
 #include "request_queue.h"
 
 RequestQueue::RequestQueue(const SearchServer& search_server)
-    :search_server_(search_server) {}
+    :search_server_(search_server) {
+    for (auto& slot : slots_) {
+        slot.store(0, memory_order_relaxed);
+    }
+}
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
+    const auto start = Clock::now();
     auto result = search_server_.FindTopDocuments(raw_query, status);
-    CheckRequests(result, raw_query);
+    RecordRequest(result.empty(), Clock::now() - start);
     return result;
 }
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
+    const auto start = Clock::now();
     auto result = search_server_.FindTopDocuments(raw_query);
-    CheckRequests(result, raw_query);
+    RecordRequest(result.empty(), Clock::now() - start);
     return result;
 }
 int RequestQueue::GetNoResultRequests() const {
-    return empty_requests_;
+    return GetStats().no_result_requests;
 }
 
-void RequestQueue::CheckRequests(vector<Document> result, const string& raw_query) {
-    requests_.push_back({ raw_query, !result.empty() });
-
-    if (!requests_.back().is_result) {
-        empty_requests_++;
+RequestStats RequestQueue::GetStats() const {
+    // The halves are sums of signed deltas: a writer may take away the request of a slot before
+    // the writer of that request has added it, so a half may be briefly negative and borrow
+    // from the other one. Both are decoded as signed values and clamped to the window
+    const uint64_t counts = counts_.load(memory_order_acquire);
+    const int64_t no_result_requests = static_cast<int32_t>(static_cast<uint32_t>(counts));
+    const int64_t requests = static_cast<int32_t>(static_cast<uint32_t>((counts - static_cast<uint64_t>(no_result_requests)) >> count_shift_));
+    RequestStats stats;
+    stats.requests = static_cast<int>(clamp<int64_t>(requests, 0, min_in_day_));
+    stats.no_result_requests = static_cast<int>(clamp<int64_t>(no_result_requests, 0, stats.requests));
+    stats.hit_requests = stats.requests - stats.no_result_requests;
+    const int64_t total_latency = static_cast<int64_t>(total_latency_.load(memory_order_acquire));
+    if (stats.requests > 0 && total_latency > 0) {
+        stats.average_latency = chrono::nanoseconds(total_latency / stats.requests);
     }
+    return stats;
+}
 
-    if (requests_.size() - 1 == min_in_day_) {
-        if (!requests_.front().is_result)
-            empty_requests_--;
-        requests_.pop_front();
+void RequestQueue::RecordRequest(bool is_empty, Clock::duration latency) {
+    const uint64_t latency_ns = min<uint64_t>(max<int64_t>(chrono::duration_cast<chrono::nanoseconds>(latency).count(), 0), latency_mask_);
+    const uint64_t slot = next_slot_.fetch_add(1, memory_order_relaxed) % min_in_day_;
+    const uint64_t replaced = slots_[slot].exchange(used_bit_ | (is_empty ? empty_bit_ : 0) | latency_ns, memory_order_acq_rel);
+    // One fetch_add moves both counts, unsigned overflow makes the subtractions exact
+    uint64_t counts_delta = uint64_t{ is_empty ? 1u : 0u } - ((replaced & empty_bit_) != 0 ? 1 : 0);
+    if ((replaced & used_bit_) == 0) {
+        counts_delta += uint64_t{ 1 } << count_shift_;
+    }
+    if (counts_delta != 0) {
+        counts_.fetch_add(counts_delta, memory_order_release);
     }
+    total_latency_.fetch_add(latency_ns - (replaced & latency_mask_), memory_order_release);
 }
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "search_server.h"
@@ -8,6 +11,21 @@
 
 using namespace std;
 
+// Totals over the last min_in_day_ requests
+struct RequestStats {
+    int requests = 0;
+    int no_result_requests = 0;
+    int hit_requests = 0;
+    chrono::nanoseconds average_latency{ 0 };
+};
+
+// Rolling window over the last requests. AddFindRequest may be called from
+// several threads at once: every request claims a slot of a fixed ring buffer
+// with an atomic counter, exchanges its outcome with the one it replaces and adds
+// the difference to running totals. Readers load the totals in O(1) without locks.
+// The request and empty result counts share one atomic word, so they always agree
+// with each other; the latency total is a separate word and may lag them by the
+// requests being recorded at the moment.
 class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server);
@@ -16,22 +34,33 @@ public:
     vector<Document> AddFindRequest(const string& raw_query, DocumentStatus status);
     vector<Document> AddFindRequest(const string& raw_query);
     int GetNoResultRequests() const;
+    RequestStats GetStats() const;
 
 private:
-    struct QueryResult {
-        string query;
-        bool is_result;
-    };
-    deque<QueryResult> requests_;
+    using Clock = chrono::steady_clock;
+
+    // A slot packs a request: the used flag, the empty result flag and the latency in nanoseconds
+    static const uint64_t used_bit_ = uint64_t{ 1 } << 63;
+    static const uint64_t empty_bit_ = uint64_t{ 1 } << 62;
+    static const uint64_t latency_mask_ = empty_bit_ - 1;
+    // Requests are counted in the high half of counts_, empty results in the low half
+    static const int count_shift_ = 32;
+
     const static int min_in_day_ = 1440;
     const SearchServer& search_server_;
-    int empty_requests_ = 0;
-    void CheckRequests(vector<Document> result, const string& raw_query);
+    array<atomic<uint64_t>, min_in_day_> slots_;
+    atomic<uint64_t> next_slot_{ 0 };
+    // Sums over the used slots, changed with wrapping arithmetic
+    atomic<uint64_t> counts_{ 0 };
+    atomic<uint64_t> total_latency_{ 0 };
+
+    void RecordRequest(bool is_empty, Clock::duration latency);
 };
 
 template <typename DocumentPredicate>
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = Clock::now();
     auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    CheckRequests(result, raw_query);
+    RecordRequest(result.empty(), Clock::now() - start);
     return result;
-}
\ No newline at end of file
+}
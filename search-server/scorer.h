@@ -0,0 +1,57 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+
+using namespace std;
+
+struct CorpusStats {
+    size_t document_count = 0;
+    double average_document_length = 0.0;
+};
+
+// Ranking functions are template parameters of FindTopDocuments: ForWord is called once
+// per query word, and the returned word scorer is inlined into the loop over its postings.
+// term_freq is the share of the word among the document words, document_length is
+// the number of the document words without stop words.
+
+// Default ranking, the relevance is exactly term_freq * log(document_count / document_freq)
+struct TfIdfScorer {
+    struct WordScorer {
+        double inverse_document_freq;
+
+        double operator()(double term_freq, int /*document_length*/) const {
+            return term_freq * inverse_document_freq;
+        }
+    };
+
+    WordScorer ForWord(const CorpusStats& stats, size_t document_freq) const {
+        return { log(stats.document_count * 1.0 / document_freq) };
+    }
+};
+
+// TF-IDF read from the quantized impact index, it needs SearchServerOptions::quantize_impacts.
+// Queries with prefix or fuzzy words fall back to the exact TF-IDF.
+struct QuantizedTfIdfScorer : TfIdfScorer {
+};
+
+// Okapi BM25 with the usual k1 = 1.2 and b = 0.75
+struct Bm25Scorer {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    struct WordScorer {
+        double inverse_document_freq;
+        double inv_average_document_length;
+
+        double operator()(double term_freq, int document_length) const {
+            const double count = term_freq * document_length;
+            const double length_norm = K1 * (1.0 - B + B * document_length * inv_average_document_length);
+            return inverse_document_freq * count * (K1 + 1.0) / (count + length_norm);
+        }
+    };
+
+    WordScorer ForWord(const CorpusStats& stats, size_t document_freq) const {
+        const double inverse_document_freq = log(1.0 + (stats.document_count - document_freq + 0.5) / (document_freq + 0.5));
+        return { inverse_document_freq, stats.average_document_length > 0 ? 1.0 / stats.average_document_length : 0.0 };
+    }
+};
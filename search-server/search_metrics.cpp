@@ -0,0 +1,241 @@
+#include "search_metrics.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+const array<string_view, static_cast<size_t>(SearchStage::COUNT)> STAGE_NAMES = {
+    "parse"sv, "posting_scan"sv, "minus_filter"sv, "top_k"sv, "match"sv, "query"sv,
+};
+
+const array<string_view, static_cast<size_t>(SearchCounter::COUNT)> COUNTER_NAMES = {
+    "postings_touched"sv, "candidates_scored"sv, "queries_processed"sv, "tier_hits"sv, "tier_fallbacks"sv, "budget_exhausted"sv,
+};
+
+// Only the owning thread writes to a shard. Relaxed atomics let other threads
+// read it for a snapshot at the cost of a plain store on x86 and ARM.
+struct MetricsShard {
+    struct Histogram {
+        array<atomic<uint64_t>, LatencyHistogram::bucket_count_> buckets{};
+        atomic<uint64_t> sum{ 0 };
+        atomic<uint64_t> min{ UINT64_MAX };
+        atomic<uint64_t> max{ 0 };
+    };
+
+    array<Histogram, static_cast<size_t>(SearchStage::COUNT)> stages;
+    array<atomic<uint64_t>, static_cast<size_t>(SearchCounter::COUNT)> counters{};
+};
+
+void Increase(atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+class MetricsRegistry {
+public:
+    shared_ptr<MetricsShard> AddShard() {
+        auto shard = make_shared<MetricsShard>();
+        lock_guard guard(mutex_);
+        shards_.push_back(shard);
+        return shard;
+    }
+
+    vector<shared_ptr<MetricsShard>> GetShards() {
+        lock_guard guard(mutex_);
+        return shards_;
+    }
+
+private:
+    mutex mutex_;
+    // Shards outlive their threads so that the work of finished threads is kept
+    vector<shared_ptr<MetricsShard>> shards_;
+};
+
+MetricsRegistry& GetRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsShard& GetThreadShard() {
+    thread_local const shared_ptr<MetricsShard> shard = GetRegistry().AddShard();
+    return *shard;
+}
+
+void PrintJsonNumber(ostream& out, string_view name, uint64_t value, bool last = false) {
+    out << '"' << name << "\":"sv << value << (last ? ""sv : ","sv);
+}
+
+} // namespace
+
+int LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < sub_bucket_count_) {
+        return static_cast<int>(value);
+    }
+    int highest_bit = 0;
+    for (int shift = 32; shift > 0; shift /= 2) {
+        if (value >> (highest_bit + shift)) {
+            highest_bit += shift;
+        }
+    }
+    const int sub_bucket = static_cast<int>((value >> (highest_bit - sub_bucket_bits_)) & (sub_bucket_count_ - 1));
+    return (highest_bit - sub_bucket_bits_ + 1) * sub_bucket_count_ + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(int index) {
+    if (index < sub_bucket_count_) {
+        return index;
+    }
+    const int highest_bit = index / sub_bucket_count_ + sub_bucket_bits_ - 1;
+    const uint64_t sub_bucket = index % sub_bucket_count_;
+    return (uint64_t{ 1 } << highest_bit) | (sub_bucket << (highest_bit - sub_bucket_bits_));
+}
+
+LatencyHistogram::LatencyHistogram(const array<uint64_t, bucket_count_>& buckets, uint64_t sum, uint64_t min, uint64_t max)
+    : buckets_(buckets)
+    , count_(accumulate(buckets.begin(), buckets.end(), uint64_t{ 0 }))
+    , sum_(sum)
+    , min_(min)
+    , max_(max) {
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    ++buckets_[GetBucketIndex(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < bucket_count_; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+uint64_t LatencyHistogram::GetMin() const {
+    return count_ == 0 ? 0 : min_;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_;
+}
+
+double LatencyHistogram::GetMean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+}
+
+uint64_t LatencyHistogram::GetValueAtQuantile(double quantile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * count_ + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < bucket_count_; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::max(GetBucketLowerBound(i), GetMin());
+        }
+    }
+    return max_;
+}
+
+void RecordSearchStage(SearchStage stage, uint64_t nanoseconds) {
+    auto& histogram = GetThreadShard().stages[static_cast<size_t>(stage)];
+    Increase(histogram.buckets[LatencyHistogram::GetBucketIndex(nanoseconds)], 1);
+    Increase(histogram.sum, nanoseconds);
+    if (nanoseconds < histogram.min.load(memory_order_relaxed)) {
+        histogram.min.store(nanoseconds, memory_order_relaxed);
+    }
+    if (nanoseconds > histogram.max.load(memory_order_relaxed)) {
+        histogram.max.store(nanoseconds, memory_order_relaxed);
+    }
+}
+
+void AddSearchCounter(SearchCounter counter, uint64_t value) {
+    Increase(GetThreadShard().counters[static_cast<size_t>(counter)], value);
+}
+
+SearchMetrics GetSearchMetrics() {
+    SearchMetrics result;
+    for (const auto& shard : GetRegistry().GetShards()) {
+        for (size_t stage = 0; stage < result.stages.size(); ++stage) {
+            const auto& source = shard->stages[stage];
+            array<uint64_t, LatencyHistogram::bucket_count_> buckets;
+            for (int i = 0; i < LatencyHistogram::bucket_count_; ++i) {
+                buckets[i] = source.buckets[i].load(memory_order_relaxed);
+            }
+            result.stages[stage].Merge(LatencyHistogram(buckets, source.sum.load(memory_order_relaxed),
+                source.min.load(memory_order_relaxed), source.max.load(memory_order_relaxed)));
+        }
+        for (size_t counter = 0; counter < result.counters.size(); ++counter) {
+            result.counters[counter] += shard->counters[counter].load(memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+// Values recorded concurrently with the reset may partially survive it
+void ResetSearchMetrics() {
+    for (const auto& shard : GetRegistry().GetShards()) {
+        for (auto& histogram : shard->stages) {
+            for (auto& bucket : histogram.buckets) {
+                bucket.store(0, memory_order_relaxed);
+            }
+            histogram.sum.store(0, memory_order_relaxed);
+            histogram.min.store(UINT64_MAX, memory_order_relaxed);
+            histogram.max.store(0, memory_order_relaxed);
+        }
+        for (auto& counter : shard->counters) {
+            counter.store(0, memory_order_relaxed);
+        }
+    }
+}
+
+void PrintSearchMetrics(ostream& out, const SearchMetrics& metrics) {
+    for (size_t stage = 0; stage < metrics.stages.size(); ++stage) {
+        const auto& histogram = metrics.stages[stage];
+        out << STAGE_NAMES[stage] << ": count = "sv << histogram.GetCount()
+            << ", min = "sv << histogram.GetMin()
+            << " ns, mean = "sv << static_cast<uint64_t>(histogram.GetMean())
+            << " ns, p50 = "sv << histogram.GetValueAtQuantile(0.5)
+            << " ns, p90 = "sv << histogram.GetValueAtQuantile(0.9)
+            << " ns, p99 = "sv << histogram.GetValueAtQuantile(0.99)
+            << " ns, max = "sv << histogram.GetMax() << " ns"sv << endl;
+    }
+    for (size_t counter = 0; counter < metrics.counters.size(); ++counter) {
+        out << COUNTER_NAMES[counter] << ": "sv << metrics.counters[counter] << endl;
+    }
+}
+
+void PrintSearchMetricsJson(ostream& out, const SearchMetrics& metrics) {
+    out << "{\"stages\":{"sv;
+    for (size_t stage = 0; stage < metrics.stages.size(); ++stage) {
+        const auto& histogram = metrics.stages[stage];
+        out << (stage == 0 ? ""sv : ","sv) << '"' << STAGE_NAMES[stage] << "\":{"sv;
+        PrintJsonNumber(out, "count"sv, histogram.GetCount());
+        PrintJsonNumber(out, "min_ns"sv, histogram.GetMin());
+        PrintJsonNumber(out, "mean_ns"sv, static_cast<uint64_t>(histogram.GetMean()));
+        PrintJsonNumber(out, "p50_ns"sv, histogram.GetValueAtQuantile(0.5));
+        PrintJsonNumber(out, "p90_ns"sv, histogram.GetValueAtQuantile(0.9));
+        PrintJsonNumber(out, "p99_ns"sv, histogram.GetValueAtQuantile(0.99));
+        PrintJsonNumber(out, "max_ns"sv, histogram.GetMax(), true);
+        out << '}';
+    }
+    out << "},\"counters\":{"sv;
+    for (size_t counter = 0; counter < metrics.counters.size(); ++counter) {
+        PrintJsonNumber(out, COUNTER_NAMES[counter], metrics.counters[counter], counter + 1 == metrics.counters.size());
+    }
+    out << "}}"sv << endl;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+// Per-stage latency histograms and work counters of the query path.
+// Recording is compiled in only when SEARCH_SERVER_METRICS is defined,
+// otherwise SEARCH_STAGE and SEARCH_COUNT expand to nothing.
+
+enum class SearchStage {
+    PARSE,
+    POSTING_SCAN,
+    MINUS_FILTER,
+    TOP_K,
+    MATCH,
+    QUERY,
+    COUNT,
+};
+
+enum class SearchCounter {
+    POSTINGS_TOUCHED,
+    CANDIDATES_SCORED,
+    QUERIES_PROCESSED,
+    TIER_HITS,       // Queries answered from the posting tiers
+    TIER_FALLBACKS,  // Tiered queries which had to scan whole posting lists
+    BUDGET_EXHAUSTED,  // Queries cut short by SearchOptions::max_postings or time_budget
+    COUNT,
+};
+
+// HDR-style histogram of nanosecond values: a value is bucketed by its highest
+// bit and then by the next sub_bucket_bits_ bits, so the relative error stays below 1/16
+class LatencyHistogram {
+public:
+    static const int sub_bucket_bits_ = 4;
+    static const int sub_bucket_count_ = 1 << sub_bucket_bits_;
+    static const int bucket_count_ = (64 - sub_bucket_bits_ + 1) * sub_bucket_count_;
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const array<uint64_t, bucket_count_>& buckets, uint64_t sum, uint64_t min, uint64_t max);
+
+    void Record(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const;
+    uint64_t GetMin() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    // Lower bound of the bucket holding the quantile, 0 <= quantile <= 1
+    uint64_t GetValueAtQuantile(double quantile) const;
+
+    static int GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketLowerBound(int index);
+
+private:
+    array<uint64_t, bucket_count_> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+struct SearchMetrics {
+    array<LatencyHistogram, static_cast<size_t>(SearchStage::COUNT)> stages;
+    array<uint64_t, static_cast<size_t>(SearchCounter::COUNT)> counters{};
+};
+
+// Every thread records into its own shard, these calls only touch the shard of the caller
+void RecordSearchStage(SearchStage stage, uint64_t nanoseconds);
+void AddSearchCounter(SearchCounter counter, uint64_t value);
+
+// Merges the shards of all threads, may be called while queries are running
+SearchMetrics GetSearchMetrics();
+void ResetSearchMetrics();
+
+void PrintSearchMetrics(ostream& out, const SearchMetrics& metrics);
+void PrintSearchMetricsJson(ostream& out, const SearchMetrics& metrics);
+
+class SearchStageTimer {
+public:
+    using Clock = chrono::steady_clock;
+
+    explicit SearchStageTimer(SearchStage stage)
+        : stage_(stage) {
+    }
+
+    ~SearchStageTimer() {
+        RecordSearchStage(stage_, chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start_time_).count());
+    }
+
+private:
+    const SearchStage stage_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+#define SEARCH_METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define SEARCH_METRICS_CONCAT(X, Y) SEARCH_METRICS_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_METRICS
+#define SEARCH_STAGE(stage) SearchStageTimer SEARCH_METRICS_CONCAT(searchStageTimer, __LINE__)(stage)
+#define SEARCH_COUNT(counter, value) AddSearchCounter(counter, value)
+#else
+#define SEARCH_STAGE(stage)
+#define SEARCH_COUNT(counter, value)
+#endif
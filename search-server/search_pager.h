@@ -0,0 +1,50 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "search_server.h"
+
+using namespace std;
+
+// Fetches ranked results page by page on demand. Every page is requested with
+// the cursor of the previous one, so earlier pages are neither kept nor recomputed.
+// The predicate may be a DocumentStatus or any predicate accepted by FindTopDocuments.
+template <typename DocumentPredicate>
+class SearchPager {
+public:
+    SearchPager(const SearchServer& search_server, string raw_query, DocumentPredicate document_predicate, size_t page_size,
+        optional<SearchCursor> cursor = nullopt)
+        : search_server_(search_server)
+        , raw_query_(move(raw_query))
+        , document_predicate_(document_predicate)
+        , page_size_(page_size)
+        , cursor_(cursor) {
+    }
+
+    bool HasNextPage() const {
+        return has_next_page_;
+    }
+
+    vector<Document> NextPage() {
+        SearchOptions options;
+        options.limit = page_size_;
+        options.search_after = cursor_;
+        auto result = search_server_.FindTopDocuments(raw_query_, document_predicate_, options);
+        cursor_ = result.next_cursor;
+        has_next_page_ = cursor_.has_value();
+        return move(result.documents);
+    }
+
+    // Cursor of the last fetched page, it can be saved with EncodeCursor to resume later
+    const optional<SearchCursor>& GetCursor() const {
+        return cursor_;
+    }
+
+private:
+    const SearchServer& search_server_;
+    string raw_query_;
+    DocumentPredicate document_predicate_;
+    size_t page_size_;
+    optional<SearchCursor> cursor_;
+    bool has_next_page_ = true;
+};
@@ -1,145 +1,408 @@
 #include "search_server.h"
 
 
-SearchServer::SearchServer(const string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor
-                                                        // from string container
+SearchServer::SearchServer(const string& stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text), options)  // Invoke delegating constructor
+                                                                // from string container
 {
 }
 
-SearchServer::SearchServer(string_view stop_words)
-    : SearchServer(SplitIntoWords(stop_words))
+SearchServer::SearchServer(string_view stop_words, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words), options)
 {
 }
 
-
-void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
-        throw invalid_argument("Invalid document_id"s);
+SearchServer::SearchServer(set<string> stop_words, optional<StopWordSet> stop_word_table, const SearchServerOptions& options)
+    : stop_words_(move(stop_words))
+    , stop_word_table_(stop_word_table ? move(*stop_word_table) : StopWordSet(stop_words_))
+    , options_(options)
+    , memory_resource_(options.memory_resource ? options.memory_resource : pmr::get_default_resource())
+    , word_to_document_freqs_(memory_resource_)
+    , status_word_to_document_freqs_(MakeStatusIndexes(memory_resource_))
+    , documents_(memory_resource_)
+    , document_ids_(memory_resource_)
+    , all_words_(memory_resource_)
+    , word_to_term_id_(memory_resource_)
+    , rating_document_ids_(memory_resource_)
+    , word_to_impacts_(memory_resource_)
+    , word_to_tiers_(memory_resource_)
+{
+    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+        throw invalid_argument("Some of stop words are invalid"s);
     }
-    
-    auto element = all_words_.emplace(document);
-    const auto words = SplitIntoWordsNoStop(*element.first);
-    const double inv_word_count = 1.0 / words.size();
-    for (const auto word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    if (options_.hot_term_count > 0) {
+        hot_terms_ = make_unique<HotTermCache>();
+    }
+    if (options_.tiered_postings) {
+        tier_counters_ = make_unique<TierCounters>();
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    document_ids_.insert(document_id);
 }
 
+namespace {
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(execution::seq, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+void AppendVarint(uint32_t value, vector<uint8_t>& bytes) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
-    return FindTopDocuments(execution::seq, raw_query, DocumentStatus::ACTUAL);
+// Tree node with three pointers and the color, malloc adds a header and aligns to 16 bytes
+size_t EstimateNodeBytes(size_t value_size) {
+    const size_t node_size = 4 * sizeof(void*) + value_size + sizeof(void*);
+    return (node_size + 15) / 16 * 16;
 }
 
-int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+// Strings up to 15 characters fit into the object itself
+template <typename String>
+size_t EstimateStringBytes(const String& text) {
+    return text.size() > 15 ? (text.size() + 16) / 16 * 16 : 0;
 }
 
-set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+// Recursive graph bisection (Dhulipala et al., 2016) of the document-term graph: every
+// range of documents is split in halves, and documents are swapped between the halves
+// while this lowers the estimated log-gap cost of the posting lists
+const size_t BISECTION_LEAF_SIZE = 16;
+const int BISECTION_ITERATIONS = 8;
+
+struct BisectionDocument {
+    int document_id;
+    const int* term_ids;
+    size_t term_count;
+    double gain;
+};
+
+// Arrays indexed by term id, only the terms of the current range are non-zero
+struct BisectionState {
+    explicit BisectionState(size_t term_count)
+        : left_degrees(term_count)
+        , right_degrees(term_count)
+        , left_gains(term_count)
+        , right_gains(term_count) {
+    }
+
+    vector<int> left_degrees;
+    vector<int> right_degrees;
+    // Cost decrease when a document with the term moves from the left or the right half
+    vector<double> left_gains;
+    vector<double> right_gains;
+    vector<int> terms;
+};
+
+// Estimated bits of the gaps of a term found in degree of count documents
+double BisectionCost(int degree, size_t count) {
+    return degree * log2(count / (degree + 1.0));
 }
 
-set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+void BisectDocuments(vector<BisectionDocument>::iterator first, vector<BisectionDocument>::iterator last, BisectionState& state) {
+    const size_t size = last - first;
+    if (size <= BISECTION_LEAF_SIZE) {
+        return;
+    }
+    const auto middle = first + size / 2;
+    const size_t left_size = middle - first;
+    const size_t right_size = last - middle;
+
+    state.terms.clear();
+    for (auto it = first; it != last; ++it) {
+        for (size_t i = 0; i < it->term_count; ++i) {
+            const int term_id = it->term_ids[i];
+            if (state.left_degrees[term_id] == 0 && state.right_degrees[term_id] == 0) {
+                state.terms.push_back(term_id);
+            }
+            ++(it < middle ? state.left_degrees : state.right_degrees)[term_id];
+        }
+    }
+
+    auto by_gain = [](const BisectionDocument& lhs, const BisectionDocument& rhs) {
+        return lhs.gain != rhs.gain ? lhs.gain > rhs.gain : lhs.document_id < rhs.document_id;
+    };
+    for (int iteration = 0; iteration < BISECTION_ITERATIONS; ++iteration) {
+        for (const int term_id : state.terms) {
+            const int left = state.left_degrees[term_id];
+            const int right = state.right_degrees[term_id];
+            const double cost = BisectionCost(left, left_size) + BisectionCost(right, right_size);
+            state.left_gains[term_id] = left > 0 ? cost - BisectionCost(left - 1, left_size) - BisectionCost(right + 1, right_size) : 0.0;
+            state.right_gains[term_id] = right > 0 ? cost - BisectionCost(left + 1, left_size) - BisectionCost(right - 1, right_size) : 0.0;
+        }
+        for (auto it = first; it != last; ++it) {
+            const auto& gains = it < middle ? state.left_gains : state.right_gains;
+            it->gain = 0.0;
+            for (size_t i = 0; i < it->term_count; ++i) {
+                it->gain += gains[it->term_ids[i]];
+            }
+        }
+        sort(first, middle, by_gain);
+        sort(middle, last, by_gain);
+
+        size_t swap_count = 0;
+        for (auto left = first, right = middle; left != middle && right != last && left->gain + right->gain > 0; ++left, ++right) {
+            for (size_t i = 0; i < left->term_count; ++i) {
+                --state.left_degrees[left->term_ids[i]];
+                ++state.right_degrees[left->term_ids[i]];
+            }
+            for (size_t i = 0; i < right->term_count; ++i) {
+                --state.right_degrees[right->term_ids[i]];
+                ++state.left_degrees[right->term_ids[i]];
+            }
+            iter_swap(left, right);
+            ++swap_count;
+        }
+        if (swap_count == 0) {
+            break;
+        }
+    }
+
+    for (const int term_id : state.terms) {
+        state.left_degrees[term_id] = 0;
+        state.right_degrees[term_id] = 0;
+    }
+    BisectDocuments(first, middle, state);
+    BisectDocuments(middle, last, state);
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static map<string_view, double> word_frequencies = {};
-        if (document_to_word_freqs_.count(document_id))
-            return document_to_word_freqs_.at(document_id);
-        else
-            return word_frequencies;
+} // namespace
+
+
+void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    
+    const string_view text = StoreDocumentText(document);
+    vector<uint32_t> positions;
+    const auto words = SplitIntoWordsNoStop(text, options_.store_positions ? &positions : nullptr);
+    IndexDocument(document_id, words, positions, status, ratings);
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    for (auto [word, freq] : document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(*all_words_.find(word)).erase(document_id);
+void SearchServer::AddDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const vector<int>& ratings) {
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
     }
 
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+    const string_view text = StoreDocumentText(document.text);
+    vector<string_view> words;
+    words.reserve(document.words.size());
+    for (const auto word : document.words) {
+        words.push_back(text.substr(word.data() - document.text.data(), word.size()));
+    }
+    IndexDocument(document_id, words, document.positions, status, ratings);
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query, true);
+string_view SearchServer::StoreDocumentText(string_view text) {
+    const auto [it, inserted] = all_words_.emplace(text);
+    if (inserted) {
+        document_text_bytes_ += EstimateNodeBytes(sizeof(pmr::string)) + EstimateStringBytes(*it);
+    }
+    return *it;
+}
 
-    vector<string_view> matched_words;
-    for (const auto word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+TokenizedDocument SearchServer::TokenizeDocument(string_view text) const {
+    TokenizedDocument document;
+    document.text = text;
+    document.words = SplitIntoWordsNoStop(text, options_.store_positions ? &document.positions : nullptr);
+    return document;
+}
+
+void SearchServer::IndexDocument(int document_id, const vector<string_view>& words, const vector<uint32_t>& positions, DocumentStatus status,
+    const vector<int>& ratings) {
+    const double inv_word_count = 1.0 / words.size();
+
+    // Term ids with word positions, sorted by term id and then by position
+    vector<pair<int, uint32_t>> term_ids;
+    term_ids.reserve(words.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        term_ids.push_back({ GetOrAddTermId(words[i]), positions.empty() ? 0 : positions[i] });
+    }
+    sort(term_ids.begin(), term_ids.end());
+
+    DocumentData document_data{ ComputeAverageRating(ratings), status, forward_term_ids_.size() };
+    for (auto it = term_ids.begin(); it != term_ids.end();) {
+        const int term_id = it->first;
+        if (options_.store_positions) {
+            forward_position_offsets_.push_back(position_bytes_.size());
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { {}, documents_.at(document_id).status };
+        double term_freq = 0.0;
+        uint32_t previous_position = 0;
+        for (; it != term_ids.end() && it->first == term_id; ++it) {
+            term_freq += inv_word_count;
+            if (options_.store_positions) {
+                AppendVarint(it->second - previous_position, position_bytes_);
+                previous_position = it->second;
+            }
+        }
+        forward_term_ids_.push_back(term_id);
+        forward_freqs_.push_back(term_freq);
+        word_to_document_freqs_[term_id_to_word_[term_id]][document_id] = term_freq;
+        if (options_.partition_by_status) {
+            status_word_to_document_freqs_[static_cast<int>(status)][term_id_to_word_[term_id]][document_id] = term_freq;
+        }
+        if (options_.tiered_postings) {
+            AddTierPosting(term_id_to_word_[term_id], document_id, term_freq);
+        }
+        if (hot_terms_) {
+            if (const auto term = hot_terms_->terms.find(term_id_to_word_[term_id]); term != hot_terms_->terms.end()) {
+                term->second.tiers[static_cast<int>(status)].Add(HOT_TERM_TOP_SIZE, document_id, term_freq);
+            }
         }
     }
+    document_data.forward_size = forward_term_ids_.size() - document_data.forward_offset;
+    posting_count_ += document_data.forward_size;
+    document_data.word_count = static_cast<int>(words.size());
+    total_word_count_ += words.size();
 
-    for (const auto word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    documents_.emplace(document_id, document_data);
+    rating_document_ids_.insert({ document_data.rating, document_id });
+    document_ids_.insert(document_id);
+
+    if (options_.quantize_impacts) {
+        if (++impact_changes_ * IMPACT_REQUANTIZATION_RATIO > documents_.size()) {
+            RequantizeImpacts();
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        else {
+            AddDocumentImpacts(document_id);
         }
     }
+}
+
 
-    return { matched_words, documents_.at(document_id).status };
+int SearchServer::GetDocumentCount() const {
+    return documents_.size();
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::sequenced_policy&, string_view raw_query, int document_id) const {
-    return MatchDocument(raw_query, document_id);
+size_t SearchServer::GetPositionalIndexMemory() const {
+    return position_bytes_.capacity() * sizeof(uint8_t) + forward_position_offsets_.capacity() * sizeof(size_t);
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::parallel_policy&, string_view raw_query, int document_id) const {
-    if (documents_.count(document_id) == 0) {
-        throw out_of_range("No document with id "s + to_string(document_id));
+MemoryStats SearchServer::GetMemoryStats() const {
+    const size_t posting_bytes = EstimateNodeBytes(sizeof(Postings::value_type));
+    const size_t word_bytes = EstimateNodeBytes(sizeof(WordIndex::value_type));
+
+    MemoryStats stats;
+    stats.inverted_index = word_to_document_freqs_.size() * word_bytes + posting_count_ * posting_bytes;
+    if (options_.partition_by_status) {
+        for (const auto& partition : status_word_to_document_freqs_) {
+            stats.status_partitions += partition.size() * word_bytes;
+        }
+        stats.status_partitions += posting_count_ * posting_bytes;
+    }
+    stats.forward_index = forward_term_ids_.capacity() * sizeof(int) + forward_freqs_.capacity() * sizeof(double);
+    stats.positions = GetPositionalIndexMemory();
+    stats.document_text = document_text_bytes_;
+    stats.dictionary = word_to_term_id_.size() * EstimateNodeBytes(sizeof(decltype(word_to_term_id_)::value_type))
+        + term_id_to_word_.capacity() * sizeof(string_view);
+    for (const string& word : stop_words_) {
+        stats.stop_words += EstimateNodeBytes(sizeof(string)) + EstimateStringBytes(word);
+    }
+    stats.stop_words += stop_word_table_.GetTableBytes();
+    stats.documents = documents_.size() * EstimateNodeBytes(sizeof(decltype(documents_)::value_type))
+        + document_ids_.size() * EstimateNodeBytes(sizeof(int))
+        + rating_document_ids_.size() * EstimateNodeBytes(sizeof(pair<int, int>));
+    stats.impact_index = word_to_impacts_.size() * EstimateNodeBytes(sizeof(decltype(word_to_impacts_)::value_type))
+        + impact_posting_count_ * (sizeof(uint32_t) + sizeof(uint16_t)) + impact_document_ids_.capacity() * sizeof(int);
+    stats.posting_tiers = word_to_tiers_.size() * EstimateNodeBytes(sizeof(decltype(word_to_tiers_)::value_type))
+        + tier_posting_count_ * sizeof(pair<double, int>);
+    if (hot_terms_) {
+        lock_guard guard(hot_terms_->access);
+        stats.hot_terms = hot_terms_->terms.size() * EstimateNodeBytes(sizeof(decltype(hot_terms_->terms)::value_type))
+            + hot_terms_->query_counts.size() * EstimateNodeBytes(sizeof(decltype(hot_terms_->query_counts)::value_type));
+        for (const auto& [word, term] : hot_terms_->terms) {
+            for (const PostingTier& tier : term.tiers) {
+                stats.hot_terms += tier.postings.capacity() * sizeof(pair<double, int>);
+            }
+        }
     }
+    stats.total = stats.inverted_index + stats.status_partitions + stats.forward_index + stats.positions + stats.document_text
+        + stats.dictionary + stats.stop_words + stats.documents + stats.impact_index + stats.posting_tiers + stats.hot_terms;
+    return stats;
+}
 
-    Query query = ParseQuery(raw_query, false);
-    vector<string_view> matched_words;
-    auto policy = execution::par;
+SearchServer::const_iterator SearchServer::begin() const {
+    return document_ids_.begin();
+}
+
+SearchServer::const_iterator SearchServer::end() const {
+    return document_ids_.end();
+}
 
-    if (any_of(
-        policy,
-        query.minus_words.begin(),
-        query.minus_words.end(),
-        [this, document_id](auto word) {
-            return (document_to_word_freqs_.at(document_id).count(word) != 0);
-        })) {
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return {};
+    }
+    const size_t offset = document->second.forward_offset;
+    return { &term_id_to_word_, forward_term_ids_.data() + offset, forward_freqs_.data() + offset, document->second.forward_size };
+}
 
-        return { {}, documents_.at(document_id).status };
+void SearchServer::RemoveDocument(int document_id) {
+    const DocumentData& document_data = documents_.at(document_id);
+    for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+        word_to_document_freqs_.at(term_id_to_word_[forward_term_ids_[i]]).erase(document_id);
+        if (options_.partition_by_status) {
+            status_word_to_document_freqs_[static_cast<int>(document_data.status)].at(term_id_to_word_[forward_term_ids_[i]]).erase(document_id);
+        }
     }
 
-    matched_words.resize(query.plus_words.size());
+    EraseDocumentData(document_id);
+}
 
-    auto it = copy_if(
-        policy,
-        query.plus_words.begin(),
-        query.plus_words.end(),
-        matched_words.begin(),
-        [this, document_id](auto word) {
-            return (document_to_word_freqs_.at(document_id).count(word) != 0);
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status) {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        throw out_of_range("No document with id "s + to_string(document_id));
+    }
+    DocumentData& document_data = document->second;
+    if (document_data.status == status) {
+        return;
+    }
+    if (options_.partition_by_status) {
+        // The forward index gives the words and frequencies to move without scanning any posting list
+        auto& old_partition = status_word_to_document_freqs_[static_cast<int>(document_data.status)];
+        auto& new_partition = status_word_to_document_freqs_[static_cast<int>(status)];
+        for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+            const string_view word = term_id_to_word_[forward_term_ids_[i]];
+            old_partition.at(word).erase(document_id);
+            new_partition[word][document_id] = forward_freqs_[i];
         }
-    );
+    }
+    const DocumentStatus old_status = document_data.status;
+    document_data.status = status;
+    if (hot_terms_) {
+        for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+            const string_view word = term_id_to_word_[forward_term_ids_[i]];
+            if (const auto term = hot_terms_->terms.find(word); term != hot_terms_->terms.end()) {
+                EraseHotTermPosting(word, old_status, document_id, forward_freqs_[i]);
+                term->second.tiers[static_cast<int>(status)].Add(HOT_TERM_TOP_SIZE, document_id, forward_freqs_[i]);
+            }
+        }
+    }
+}
 
-    sort(policy, matched_words.begin(), it);
-    it = unique(policy, matched_words.begin(), it);
-    matched_words.erase(it, matched_words.end());
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    if (documents_.count(document_id) == 0) {
+        throw out_of_range("No document with id "s + to_string(document_id));
+    }
+
+    const ResolvedQuery query = ResolveQuery(ParseQuery(raw_query, false));
 
-    return { matched_words, documents_.at(document_id).status };
+    vector<string_view> matched_words;
+    const DocumentStatus status = MatchResolvedQuery(query, document_id, matched_words);
+    return { matched_words, status };
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::sequenced_policy&, string_view raw_query, int document_id) const {
+    return MatchDocument(raw_query, document_id);
+}
+
+// Matching of a single document is a short sorted intersection,
+// it is not worth splitting between threads
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::parallel_policy&, string_view raw_query, int document_id) const {
+    return MatchDocument(raw_query, document_id);
 }
 
 bool SearchServer::IsStopWord(string_view word) const {
-    return stop_words_.count(static_cast<string>(word)) > 0;
+    return stop_word_table_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(string_view word) {
@@ -149,15 +412,20 @@ bool SearchServer::IsValidWord(string_view word) {
         });
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
+vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text, vector<uint32_t>* positions) const {
     vector<string_view> words;
+    uint32_t position = 0;
     for (const auto word : SplitIntoWords(text)) {
         if (!IsValidWord(word)) {
             throw invalid_argument("Word "s + static_cast<string>(word) + " is invalid"s);
         }
         if (!IsStopWord(word)) {
             words.push_back(word);
+            if (positions) {
+                positions->push_back(position);
+            }
         }
+        ++position;
     }
     return words;
 }
@@ -176,27 +444,70 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     }
     string_view word = text;
     bool is_minus = false;
+    bool is_required = false;
     if (word[0] == '-') {
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    // A lone "+" is an ordinary word
+    else if (word[0] == '+' && word.size() > 1) {
+        is_required = true;
+        word = word.substr(1);
+    }
+    if (word.empty() || word[0] == '-' || (word[0] == '+' && (is_minus || is_required)) || !IsValidWord(word)) {
         throw invalid_argument("Query word "s + static_cast<string>(text) + " is invalid");
     }
+    // A lone "*" is an ordinary word
+    if (word.size() > 1 && word.back() == '*') {
+        if (is_required) {
+            throw invalid_argument("Prefix query word "s + static_cast<string>(text) + " cannot be required"s);
+        }
+        return { word.substr(0, word.size() - 1), is_minus, false, true, 0 };
+    }
+    // word~ allows the largest edit distance, word~0 is an exact word
+    if (const size_t tilde = word.rfind('~'); tilde != word.npos && tilde > 0) {
+        const string_view distance = word.substr(tilde + 1);
+        if (all_of(distance.begin(), distance.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            if (distance.size() > 1 || (!distance.empty() && distance[0] - '0' > MAX_EDIT_DISTANCE)) {
+                throw invalid_argument("Edit distance of query word "s + static_cast<string>(text) + " is too large"s);
+            }
+            const int max_distance = distance.empty() ? MAX_EDIT_DISTANCE : distance[0] - '0';
+            if (is_required && max_distance > 0) {
+                throw invalid_argument("Fuzzy query word "s + static_cast<string>(text) + " cannot be required"s);
+            }
+            word = word.substr(0, tilde);
+            return { word, is_minus, max_distance == 0 && IsStopWord(word), false, max_distance, is_required };
+        }
+    }
 
-    return { word, is_minus, IsStopWord(word) };
+    return { word, is_minus, IsStopWord(word), false, 0, is_required };
 }
 
 SearchServer::Query SearchServer::ParseQuery(string_view text, bool is_seq) const {
+    SEARCH_STAGE(SearchStage::PARSE);
     Query result;
-    for (const auto word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+    const auto words = SplitIntoWords(text);
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (options_.store_positions && !words[i].empty() && words[i][0] == '"') {
+            i = ParsePhrase(words, i, result);
+            continue;
+        }
+        const auto query_word = ParseQueryWord(words[i]);
+        if (query_word.is_prefix) {
+            (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).push_back(query_word.data);
+        }
+        else if (query_word.max_distance > 0) {
+            (query_word.is_minus ? result.minus_fuzzy_words : result.plus_fuzzy_words).push_back({ query_word.data, query_word.max_distance });
+        }
+        else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(query_word.data);
             }
             else {
                 result.plus_words.push_back(query_word.data);
+                if (query_word.is_required) {
+                    result.required_words.push_back(query_word.data);
+                }
             }
         }
     }
@@ -209,12 +520,845 @@ SearchServer::Query SearchServer::ParseQuery(string_view text, bool is_seq) cons
         sort(result.plus_words.begin(), result.plus_words.end());
         auto new_end_plus = unique(result.plus_words.begin(), result.plus_words.end());
         result.plus_words.erase(new_end_plus, result.plus_words.end());
+
+        sort(result.required_words.begin(), result.required_words.end());
+        result.required_words.erase(unique(result.required_words.begin(), result.required_words.end()), result.required_words.end());
+
+        for (auto* prefixes : { &result.plus_prefixes, &result.minus_prefixes }) {
+            sort(prefixes->begin(), prefixes->end());
+            prefixes->erase(unique(prefixes->begin(), prefixes->end()), prefixes->end());
+        }
+
+        for (auto* fuzzy_words : { &result.plus_fuzzy_words, &result.minus_fuzzy_words }) {
+            sort(fuzzy_words->begin(), fuzzy_words->end(), [](const FuzzyWord& lhs, const FuzzyWord& rhs) {
+                return tie(lhs.word, lhs.max_distance) < tie(rhs.word, rhs.max_distance);
+                });
+            fuzzy_words->erase(unique(fuzzy_words->begin(), fuzzy_words->end(), [](const FuzzyWord& lhs, const FuzzyWord& rhs) {
+                return lhs.word == rhs.word && lhs.max_distance == rhs.max_distance;
+                }), fuzzy_words->end());
+        }
     }
 
     return result;
 }
 
+bool SearchServer::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+size_t SearchServer::GetPageEnd(const SearchOptions& options) {
+    if (options.limit > numeric_limits<size_t>::max() - options.offset) {
+        return numeric_limits<size_t>::max();
+    }
+    return options.offset + options.limit;
+}
+
+vector<Document> SearchServer::SelectPageCandidates(vector<Document> documents, const SearchOptions& options, bool is_bounded) {
+    PageCandidates page(options, is_bounded);
+    if (!page.cursor && documents.size() <= page.capacity) {
+        return documents;
+    }
+    for (const Document& document : documents) {
+        page.Add(document);
+    }
+    return move(page.documents);
+}
+
+int SearchServer::GetOrAddTermId(string_view word) {
+    const auto [it, inserted] = word_to_term_id_.emplace(word, static_cast<int>(term_id_to_word_.size()));
+    if (inserted) {
+        term_id_to_word_.push_back(word);
+    }
+    return it->second;
+}
+
+void SearchServer::EraseDocumentData(int document_id) {
+    if (options_.tiered_postings) {
+        const DocumentData& document_data = documents_.at(document_id);
+        for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+            EraseTierPosting(term_id_to_word_[forward_term_ids_[i]], document_id, forward_freqs_[i]);
+        }
+    }
+    if (hot_terms_) {
+        const DocumentData& document_data = documents_.at(document_id);
+        for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+            EraseHotTermPosting(term_id_to_word_[forward_term_ids_[i]], document_data.status, document_id, forward_freqs_[i]);
+        }
+    }
+    forward_garbage_ += documents_.at(document_id).forward_size;
+    posting_count_ -= documents_.at(document_id).forward_size;
+    total_word_count_ -= documents_.at(document_id).word_count;
+    rating_document_ids_.erase({ documents_.at(document_id).rating, document_id });
+    if (options_.quantize_impacts) {
+        impact_document_ids_[documents_.at(document_id).impact_number] = -1;
+    }
+    documents_.erase(document_id);
+    document_ids_.erase(document_id);
+    if (options_.quantize_impacts && ++impact_changes_ * IMPACT_REQUANTIZATION_RATIO > documents_.size()) {
+        RequantizeImpacts();
+    }
+
+    if (forward_garbage_ * 2 > forward_term_ids_.size()) {
+        CompactForwardIndex();
+    }
+}
+
+void SearchServer::PostingTier::Add(size_t capacity, int document_id, double term_freq) {
+    if (postings.size() >= capacity && term_freq <= postings.front().first) {
+        tail_max_term_freq = max(tail_max_term_freq, term_freq);
+        return;
+    }
+    postings.push_back({ term_freq, document_id });
+    push_heap(postings.begin(), postings.end(), greater<>());
+    if (postings.size() > capacity) {
+        pop_heap(postings.begin(), postings.end(), greater<>());
+        tail_max_term_freq = max(tail_max_term_freq, postings.back().first);
+        postings.pop_back();
+    }
+}
+
+bool SearchServer::PostingTier::Erase(int document_id, double term_freq) {
+    const auto it = find(postings.begin(), postings.end(), pair{ term_freq, document_id });
+    if (it == postings.end()) {
+        return false;
+    }
+    *it = postings.back();
+    postings.pop_back();
+    make_heap(postings.begin(), postings.end(), greater<>());
+    return true;
+}
+
+void SearchServer::PostingTier::Assign(size_t capacity, vector<pair<double, int>> all_postings) {
+    postings = move(all_postings);
+    tail_max_term_freq = 0.0;
+    if (postings.size() > capacity) {
+        nth_element(postings.begin(), postings.begin() + capacity, postings.end(), greater<>());
+        tail_max_term_freq = max_element(postings.begin() + capacity, postings.end())->first;
+        postings.resize(capacity);
+        postings.shrink_to_fit();
+    }
+    make_heap(postings.begin(), postings.end(), greater<>());
+}
+
+void SearchServer::AddTierPosting(string_view word, int document_id, double term_freq) {
+    PostingTier& tier = word_to_tiers_[word];
+    tier_posting_count_ -= tier.postings.size();
+    tier.Add(POSTING_TIER_SIZE, document_id, term_freq);
+    tier_posting_count_ += tier.postings.size();
+}
+
+void SearchServer::EraseTierPosting(string_view word, int document_id, double term_freq) {
+    PostingTier& tier = word_to_tiers_.at(word);
+    if (!tier.Erase(document_id, term_freq)) {
+        return;
+    }
+    --tier_posting_count_;
+    if (tier.postings.size() < POSTING_TIER_SIZE / 2 && tier.tail_max_term_freq > 0) {
+        RebuildTier(word);
+    }
+}
+
+void SearchServer::RebuildTier(string_view word) {
+    PostingTier& tier = word_to_tiers_.at(word);
+    vector<pair<double, int>> postings;
+    for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        postings.push_back({ term_freq, document_id });
+    }
+    tier_posting_count_ -= tier.postings.size();
+    tier.Assign(POSTING_TIER_SIZE, move(postings));
+    tier_posting_count_ += tier.postings.size();
+}
+
+void SearchServer::EraseHotTermPosting(string_view word, DocumentStatus status, int document_id, double term_freq) {
+    const auto term = hot_terms_->terms.find(word);
+    if (term == hot_terms_->terms.end()) {
+        return;
+    }
+    PostingTier& tier = term->second.tiers[static_cast<int>(status)];
+    if (tier.Erase(document_id, term_freq) && tier.postings.size() < HOT_TERM_TOP_SIZE / 2 && tier.tail_max_term_freq > 0) {
+        RebuildHotTier(word, status, tier);
+    }
+}
+
+void SearchServer::RebuildHotTier(string_view word, DocumentStatus status, PostingTier& tier) const {
+    vector<pair<double, int>> postings;
+    if (options_.partition_by_status) {
+        const auto& partition = status_word_to_document_freqs_[static_cast<int>(status)];
+        if (const auto word_postings = partition.find(word); word_postings != partition.end()) {
+            for (const auto& [document_id, term_freq] : word_postings->second) {
+                postings.push_back({ term_freq, document_id });
+            }
+        }
+    }
+    else {
+        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+            if (documents_.at(document_id).status == status) {
+                postings.push_back({ term_freq, document_id });
+            }
+        }
+    }
+    tier.Assign(HOT_TERM_TOP_SIZE, move(postings));
+}
+
+SearchServer::HotTerm* SearchServer::AdmitHotTerm(HotTermCache& cache, string_view word, size_t query_count) const {
+    // Least frequently used eviction, the count of an evicted word is kept
+    if (cache.terms.size() >= options_.hot_term_count) {
+        const auto coldest = min_element(cache.terms.begin(), cache.terms.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.query_count < rhs.second.query_count;
+            });
+        if (coldest->second.query_count >= query_count) {
+            return nullptr;
+        }
+        cache.query_counts[coldest->first] = coldest->second.query_count;
+        cache.terms.erase(coldest);
+        ++cache.stats.evictions;
+    }
+    cache.query_counts.erase(word);
+    HotTerm& term = cache.terms[word];
+    term.query_count = query_count;
+
+    array<vector<pair<double, int>>, DOCUMENT_STATUS_COUNT> postings;
+    for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        postings[static_cast<int>(documents_.at(document_id).status)].push_back({ term_freq, document_id });
+    }
+    for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        term.tiers[status].Assign(HOT_TERM_TOP_SIZE, move(postings[status]));
+    }
+    ++cache.stats.admissions;
+    return &term;
+}
+
+optional<vector<Document>> SearchServer::FindTopDocumentsByHotTerm(const Query& query, const DocumentFilter& filter, size_t top_count) const {
+    const auto status = filter.GetSingleStatus();
+    if (query.plus_words.size() != 1 || !query.minus_words.empty() || (!query.required_words.empty() && query.required_words != query.plus_words)
+        || !query.plus_prefixes.empty() || !query.minus_prefixes.empty() || !query.plus_fuzzy_words.empty()
+        || !query.minus_fuzzy_words.empty() || !query.phrases.empty() || top_count == 0 || top_count > HOT_TERM_TOP_SIZE
+        || !status || filter.HasRatingRange() || filter.HasIdRange() || filter.HasPredicate()) {
+        return nullopt;
+    }
+    const auto postings = word_to_document_freqs_.find(query.plus_words.front());
+    if (postings == word_to_document_freqs_.end() || postings->second.size() < HOT_TERM_MIN_DOCUMENTS) {
+        return nullopt;
+    }
+    // The cache outlives the query, so it is keyed by the view of the indexed word
+    const string_view word = postings->first;
+
+    HotTermCache& cache = *hot_terms_;
+    lock_guard guard(cache.access);
+    HotTerm* term = nullptr;
+    if (const auto it = cache.terms.find(word); it != cache.terms.end()) {
+        term = &it->second;
+        ++term->query_count;
+    }
+    else {
+        term = AdmitHotTerm(cache, word, ++cache.query_counts[word]);
+    }
+    if (term == nullptr) {
+        ++cache.stats.misses;
+        return nullopt;
+    }
+
+    // Same check as for the posting tiers: every one of the first top_count documents
+    // must outrank the tail by relevance alone
+    const PostingTier& tier = term->tiers[static_cast<int>(*status)];
+    const auto word_scorer = TfIdfScorer().ForWord(GetCorpusStats(), postings->second.size());
+    vector<Document> matched_documents;
+    for (const auto& [term_freq, document_id] : tier.postings) {
+        matched_documents.push_back({ document_id, word_scorer(term_freq, 0), documents_.at(document_id).rating });
+    }
+    if (tier.tail_max_term_freq > 0) {
+        if (matched_documents.size() <= top_count) {
+            ++cache.stats.misses;
+            return nullopt;
+        }
+        nth_element(matched_documents.begin(), matched_documents.begin() + (top_count - 1), matched_documents.end(), IsRankedBefore);
+        const double min_relevance = min_element(matched_documents.begin(), matched_documents.begin() + top_count,
+            [](const Document& lhs, const Document& rhs) { return lhs.relevance < rhs.relevance; })->relevance;
+        if (min_relevance - word_scorer(tier.tail_max_term_freq, 0) < ACCURACY) {
+            ++cache.stats.misses;
+            return nullopt;
+        }
+    }
+    ++cache.stats.hits;
+    return matched_documents;
+}
+
+HotTermStats SearchServer::GetHotTermStats() const {
+    if (!hot_terms_) {
+        return {};
+    }
+    lock_guard guard(hot_terms_->access);
+    HotTermStats stats = hot_terms_->stats;
+    stats.cached_terms = hot_terms_->terms.size();
+    return stats;
+}
+
+TierStats SearchServer::GetTierStats() const {
+    if (!tier_counters_) {
+        return {};
+    }
+    return { tier_counters_->hits.load(memory_order_relaxed), tier_counters_->fallbacks.load(memory_order_relaxed) };
+}
+
+void SearchServer::CountTierQuery(bool is_hit) const {
+    if (is_hit) {
+        SEARCH_COUNT(SearchCounter::TIER_HITS, 1);
+        tier_counters_->hits.fetch_add(1, memory_order_relaxed);
+    }
+    else {
+        SEARCH_COUNT(SearchCounter::TIER_FALLBACKS, 1);
+        tier_counters_->fallbacks.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void SearchServer::CompactForwardIndex() {
+    vector<int> term_ids;
+    vector<double> freqs;
+    vector<size_t> position_offsets;
+    vector<uint8_t> position_bytes;
+    term_ids.reserve(forward_term_ids_.size() - forward_garbage_);
+    freqs.reserve(forward_term_ids_.size() - forward_garbage_);
+    for (auto& [document_id, document_data] : documents_) {
+        const size_t offset = document_data.forward_offset;
+        document_data.forward_offset = term_ids.size();
+        term_ids.insert(term_ids.end(), forward_term_ids_.begin() + offset, forward_term_ids_.begin() + offset + document_data.forward_size);
+        freqs.insert(freqs.end(), forward_freqs_.begin() + offset, forward_freqs_.begin() + offset + document_data.forward_size);
+        if (options_.store_positions && document_data.forward_size > 0) {
+            const size_t last = offset + document_data.forward_size;
+            const size_t bytes_begin = forward_position_offsets_[offset];
+            const size_t bytes_end = last < forward_position_offsets_.size() ? forward_position_offsets_[last] : position_bytes_.size();
+            for (size_t i = offset; i < last; ++i) {
+                position_offsets.push_back(forward_position_offsets_[i] - bytes_begin + position_bytes.size());
+            }
+            position_bytes.insert(position_bytes.end(), position_bytes_.begin() + bytes_begin, position_bytes_.begin() + bytes_end);
+        }
+    }
+    forward_term_ids_ = move(term_ids);
+    forward_freqs_ = move(freqs);
+    forward_position_offsets_ = move(position_offsets);
+    position_bytes_ = move(position_bytes);
+    forward_garbage_ = 0;
+}
+
+size_t SearchServer::ParsePhrase(const vector<string_view>& words, size_t first, Query& query) const {
+    Phrase phrase;
+    for (size_t i = first; i < words.size(); ++i) {
+        string_view word = words[i];
+        if (i == first) {
+            word.remove_prefix(1);
+        }
+        const bool is_last = !word.empty() && word.back() == '"';
+        if (is_last) {
+            word.remove_suffix(1);
+        }
+        if (word.empty() || word[0] == '-' || word.find('"') != word.npos || !IsValidWord(word)) {
+            throw invalid_argument("Phrase word "s + static_cast<string>(words[i]) + " is invalid"s);
+        }
+        if (!IsStopWord(word)) {
+            phrase.words.push_back(word);
+            phrase.offsets.push_back(static_cast<uint32_t>(i - first));
+            query.plus_words.push_back(word);
+        }
+        if (is_last) {
+            // A phrase of a single word is an ordinary plus word
+            if (phrase.words.size() > 1) {
+                query.phrases.push_back(move(phrase));
+            }
+            return i;
+        }
+    }
+    throw invalid_argument("Phrase is not closed"s);
+}
+
+SearchServer::ResolvedQuery SearchServer::ResolveQuery(const Query& query) const {
+    ResolvedQuery result;
+    for (const auto word : query.plus_words) {
+        if (const auto it = word_to_term_id_.find(word); it != word_to_term_id_.end()) {
+            result.plus_term_ids.push_back(it->second);
+        }
+    }
+    for (const auto word : query.minus_words) {
+        if (const auto it = word_to_term_id_.find(word); it != word_to_term_id_.end()) {
+            result.minus_term_ids.push_back(it->second);
+        }
+    }
+    for (const auto word : query.required_words) {
+        if (const auto it = word_to_term_id_.find(word); it != word_to_term_id_.end()) {
+            result.required_term_ids.push_back(it->second);
+        }
+        else {
+            result.has_unknown_required = true;
+        }
+    }
+    for (const auto prefix : query.plus_prefixes) {
+        for (const auto word : ExpandPrefix(prefix)) {
+            result.plus_term_ids.push_back(word_to_term_id_.at(word));
+        }
+    }
+    for (const auto prefix : query.minus_prefixes) {
+        for (const auto word : ExpandPrefix(prefix)) {
+            result.minus_term_ids.push_back(word_to_term_id_.at(word));
+        }
+    }
+    for (const auto& fuzzy_word : query.plus_fuzzy_words) {
+        for (const auto& [word, _] : ExpandFuzzyWord(fuzzy_word)) {
+            result.plus_term_ids.push_back(word_to_term_id_.at(word));
+        }
+    }
+    for (const auto& fuzzy_word : query.minus_fuzzy_words) {
+        for (const auto& [word, _] : ExpandFuzzyWord(fuzzy_word)) {
+            result.minus_term_ids.push_back(word_to_term_id_.at(word));
+        }
+    }
+    for (auto* term_ids : { &result.plus_term_ids, &result.minus_term_ids, &result.required_term_ids }) {
+        sort(term_ids->begin(), term_ids->end());
+        term_ids->erase(unique(term_ids->begin(), term_ids->end()), term_ids->end());
+    }
+    result.has_unknown_phrase = !ResolvePhrases(query.phrases, result.phrases);
+    return result;
+}
+
+bool SearchServer::ResolvePhrases(const vector<Phrase>& phrases, vector<ResolvedPhrase>& resolved_phrases) const {
+    for (const auto& phrase : phrases) {
+        ResolvedPhrase resolved_phrase;
+        for (size_t i = 0; i < phrase.words.size(); ++i) {
+            const auto it = word_to_term_id_.find(phrase.words[i]);
+            if (it == word_to_term_id_.end()) {
+                return false;
+            }
+            resolved_phrase.term_ids.push_back(it->second);
+            resolved_phrase.offsets.push_back(phrase.offsets[i]);
+        }
+        resolved_phrases.push_back(move(resolved_phrase));
+    }
+    return true;
+}
+
+vector<uint32_t> SearchServer::DecodePositions(size_t forward_index) const {
+    const size_t end = forward_index + 1 < forward_position_offsets_.size() ? forward_position_offsets_[forward_index + 1] : position_bytes_.size();
+    vector<uint32_t> positions;
+    uint32_t position = 0;
+    for (size_t i = forward_position_offsets_[forward_index]; i < end;) {
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            const uint8_t byte = position_bytes_[i++];
+            delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        position += delta;
+        positions.push_back(position);
+    }
+    return positions;
+}
+
+bool SearchServer::MatchesPhrase(const DocumentData& document_data, const ResolvedPhrase& phrase) const {
+    const auto first = forward_term_ids_.begin() + document_data.forward_offset;
+    const auto last = first + document_data.forward_size;
+
+    // All phrase words must be present before any positions are decoded
+    vector<size_t> entries;
+    for (const int term_id : phrase.term_ids) {
+        const auto it = lower_bound(first, last, term_id);
+        if (it == last || *it != term_id) {
+            return false;
+        }
+        entries.push_back(it - forward_term_ids_.begin());
+    }
+
+    // Candidate phrase starts are intersected word by word
+    vector<uint32_t> starts;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        vector<uint32_t> word_starts;
+        for (const uint32_t position : DecodePositions(entries[i])) {
+            if (position >= phrase.offsets[i]) {
+                word_starts.push_back(position - phrase.offsets[i]);
+            }
+        }
+        if (i == 0) {
+            starts = move(word_starts);
+        }
+        else {
+            vector<uint32_t> common_starts;
+            set_intersection(starts.begin(), starts.end(), word_starts.begin(), word_starts.end(), back_inserter(common_starts));
+            starts = move(common_starts);
+        }
+        if (starts.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DocumentStatus SearchServer::MatchResolvedQuery(const ResolvedQuery& query, int document_id, vector<string_view>& matched_words) const {
+    SEARCH_STAGE(SearchStage::MATCH);
+    const DocumentData& document_data = documents_.at(document_id);
+    const auto first = forward_term_ids_.begin() + document_data.forward_offset;
+    const auto last = first + document_data.forward_size;
+
+    bool has_minus_word = false;
+    IntersectSorted(query.minus_term_ids.begin(), query.minus_term_ids.end(), first, last, [&has_minus_word](auto, auto) {
+        has_minus_word = true;
+        });
+    if (has_minus_word || query.has_unknown_phrase || query.has_unknown_required) {
+        return document_data.status;
+    }
+    size_t required_count = 0;
+    IntersectSorted(query.required_term_ids.begin(), query.required_term_ids.end(), first, last, [&required_count](auto, auto) {
+        ++required_count;
+        });
+    if (required_count < query.required_term_ids.size()) {
+        return document_data.status;
+    }
+    for (const auto& phrase : query.phrases) {
+        if (!MatchesPhrase(document_data, phrase)) {
+            return document_data.status;
+        }
+    }
+
+    const size_t matched_begin = matched_words.size();
+    IntersectSorted(query.plus_term_ids.begin(), query.plus_term_ids.end(), first, last, [this, &matched_words](auto term_id, auto) {
+        matched_words.push_back(term_id_to_word_[*term_id]);
+        });
+    // Matched words are reported in lexicographical order
+    sort(matched_words.begin() + matched_begin, matched_words.end());
+    return document_data.status;
+}
+
 // Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+SearchServer::FilterPlan SearchServer::PlanFilter(const DocumentFilter& filter, const Query& query) const {
+    // The rating range is probed only when it is this many times smaller than the postings
+    constexpr size_t min_selectivity = 8;
+
+    FilterPlan plan{ &filter, nullopt };
+    if (!filter.HasRatingRange()) {
+        return plan;
+    }
+    size_t posting_count = 0;
+    for (const auto word : query.plus_words) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+            posting_count += it->second.size();
+        }
+    }
+
+    vector<int> candidates;
+    size_t visited_count = 0;
+    const auto first = rating_document_ids_.lower_bound({ filter.GetMinRating(), INT_MIN });
+    for (auto it = first; it != rating_document_ids_.end() && it->first <= filter.GetMaxRating(); ++it) {
+        if (++visited_count * min_selectivity > posting_count) {
+            return plan;
+        }
+        if (it->second >= filter.GetMinId() && it->second <= filter.GetMaxId()) {
+            candidates.push_back(it->second);
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    plan.candidates = move(candidates);
+    return plan;
+}
+
+SearchServer::Postings::const_iterator SearchServer::PostingLowerBound(const Postings& postings, int document_id) {
+    return postings.lower_bound(document_id);
+}
+
+vector<pair<string_view, const SearchServer::Postings*>> SearchServer::FindPostings(const vector<string_view>& words, const WordIndex& scanned_index) {
+    vector<pair<string_view, const Postings*>> result;
+    for (const auto word : words) {
+        if (const auto postings = scanned_index.find(word); postings != scanned_index.end() && !postings->second.empty()) {
+            result.push_back({ word, &postings->second });
+        }
+    }
+    return result;
+}
+
+vector<pair<string_view, const SearchServer::Postings*>> SearchServer::PlanPostings(const vector<string_view>& words, const WordIndex& scanned_index) {
+    auto result = FindPostings(words, scanned_index);
+    sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second->size() < rhs.second->size();
+        });
+    return result;
+}
+
+// Intersected lists usually advance by a few postings, the tree search handles long skips
+SearchServer::Postings::const_iterator SearchServer::SeekPosting(const Postings& postings, Postings::const_iterator it, int document_id) {
+    for (int step = 0; step < 2 && it != postings.end() && it->first < document_id; ++step) {
+        ++it;
+    }
+    if (it == postings.end() || it->first >= document_id) {
+        return it;
+    }
+    return postings.lower_bound(document_id);
+}
+
+vector<pair<int, double>>::const_iterator SearchServer::PostingLowerBound(const vector<pair<int, double>>& postings, int document_id) {
+    return lower_bound(postings.begin(), postings.end(), document_id, [](const pair<int, double>& posting, int id) {
+        return posting.first < id;
+        });
+}
+
+uint16_t SearchServer::QuantizeImpact(double impact) const {
+    // Impacts are never rounded to zero, a zero score means that nothing is found
+    const double quantized = round(impact / impact_scale_);
+    return static_cast<uint16_t>(clamp(quantized, 1.0, static_cast<double>(numeric_limits<uint16_t>::max())));
+}
+
+// Impacts of a new document use the current idf, impacts of the others are not updated
+// until the next requantization
+void SearchServer::AddDocumentImpacts(int document_id) {
+    DocumentData& document_data = documents_.at(document_id);
+    document_data.impact_number = static_cast<uint32_t>(impact_document_ids_.size());
+    impact_document_ids_.push_back(document_id);
+    for (size_t i = document_data.forward_offset; i < document_data.forward_offset + document_data.forward_size; ++i) {
+        const string_view word = term_id_to_word_[forward_term_ids_[i]];
+        const double inverse_document_freq = log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+        auto& postings = word_to_impacts_[word];
+        postings.document_numbers.push_back(document_data.impact_number);
+        postings.impacts.push_back(QuantizeImpact(forward_freqs_[i] * inverse_document_freq));
+    }
+    impact_posting_count_ += document_data.forward_size;
+}
+
+void SearchServer::RequantizeImpacts() {
+    if (reordered_document_ids_.empty()) {
+        impact_document_ids_.assign(document_ids_.begin(), document_ids_.end());
+    }
+    else {
+        // Reordered documents keep their order, the ones added since then follow by id
+        impact_document_ids_.clear();
+        for (const int document_id : reordered_document_ids_) {
+            if (documents_.count(document_id) > 0) {
+                impact_document_ids_.push_back(document_id);
+            }
+        }
+        reordered_document_ids_ = impact_document_ids_;
+        sort(reordered_document_ids_.begin(), reordered_document_ids_.end());
+        set_difference(document_ids_.begin(), document_ids_.end(), reordered_document_ids_.begin(), reordered_document_ids_.end(),
+            back_inserter(impact_document_ids_));
+        reordered_document_ids_ = impact_document_ids_;
+    }
+    for (size_t number = 0; number < impact_document_ids_.size(); ++number) {
+        documents_.at(impact_document_ids_[number]).impact_number = static_cast<uint32_t>(number);
+    }
+
+    // The largest impact gets the largest quantized value
+    double max_impact = 0.0;
+    for (const auto& [word, postings] : word_to_document_freqs_) {
+        if (postings.empty()) {
+            continue;
+        }
+        const double inverse_document_freq = log(GetDocumentCount() * 1.0 / postings.size());
+        for (const auto& [document_id, term_freq] : postings) {
+            max_impact = max(max_impact, term_freq * inverse_document_freq);
+        }
+    }
+    impact_scale_ = max_impact > 0 ? max_impact / numeric_limits<uint16_t>::max() : 1.0;
+
+    word_to_impacts_.clear();
+    for (const auto& [word, postings] : word_to_document_freqs_) {
+        if (postings.empty()) {
+            continue;
+        }
+        const double inverse_document_freq = log(GetDocumentCount() * 1.0 / postings.size());
+        auto& impacts = word_to_impacts_[word];
+        impacts.document_numbers.reserve(postings.size());
+        impacts.impacts.reserve(postings.size());
+        if (reordered_document_ids_.empty()) {
+            for (const auto& [document_id, term_freq] : postings) {
+                impacts.document_numbers.push_back(documents_.at(document_id).impact_number);
+                impacts.impacts.push_back(QuantizeImpact(term_freq * inverse_document_freq));
+            }
+            continue;
+        }
+        // Postings are ordered by the dense numbers, which no longer follow the ids
+        vector<pair<uint32_t, uint16_t>> numbered_impacts;
+        numbered_impacts.reserve(postings.size());
+        for (const auto& [document_id, term_freq] : postings) {
+            numbered_impacts.push_back({ documents_.at(document_id).impact_number, QuantizeImpact(term_freq * inverse_document_freq) });
+        }
+        sort(numbered_impacts.begin(), numbered_impacts.end());
+        for (const auto& [number, impact] : numbered_impacts) {
+            impacts.document_numbers.push_back(number);
+            impacts.impacts.push_back(impact);
+        }
+    }
+    impact_posting_count_ = posting_count_;
+    impact_changes_ = 0;
+}
+
+void SearchServer::ReorderDocuments() {
+    if (!options_.quantize_impacts) {
+        throw logic_error("Document reordering requires the impact index"s);
+    }
+    vector<BisectionDocument> bisection_documents;
+    bisection_documents.reserve(documents_.size());
+    for (const auto& [document_id, document_data] : documents_) {
+        bisection_documents.push_back({ document_id, forward_term_ids_.data() + document_data.forward_offset, document_data.forward_size, 0.0 });
+    }
+    BisectionState state(term_id_to_word_.size());
+    BisectDocuments(bisection_documents.begin(), bisection_documents.end(), state);
+
+    reordered_document_ids_.clear();
+    for (const auto& document : bisection_documents) {
+        reordered_document_ids_.push_back(document.document_id);
+    }
+    RequantizeImpacts();
+}
+
+PostingGapStats SearchServer::GetPostingGapStats() const {
+    PostingGapStats stats;
+    double log2_gap_sum = 0.0;
+    for (const auto& [word, postings] : word_to_impacts_) {
+        // The first number is stored as a gap from zero
+        uint32_t previous = 0;
+        for (const uint32_t number : postings.document_numbers) {
+            const uint32_t gap = number - previous + 1;
+            previous = number + 1;
+            int bits = 0;
+            while ((gap >> bits) > 1) {
+                ++bits;
+            }
+            ++bits;
+            ++stats.gap_bit_counts[bits];
+            stats.varint_bytes += (bits + 6) / 7;
+            log2_gap_sum += log2(static_cast<double>(gap));
+            ++stats.gap_count;
+        }
+    }
+    stats.average_log2_gap = stats.gap_count > 0 ? log2_gap_sum / stats.gap_count : 0.0;
+    return stats;
+}
+
+array<SearchServer::WordIndex, DOCUMENT_STATUS_COUNT> SearchServer::MakeStatusIndexes(pmr::memory_resource* memory_resource) {
+    static_assert(DOCUMENT_STATUS_COUNT == 4);
+    return { WordIndex(memory_resource), WordIndex(memory_resource), WordIndex(memory_resource), WordIndex(memory_resource) };
+}
+
+CorpusStats SearchServer::GetCorpusStats() const {
+    return { documents_.size(), documents_.empty() ? 0.0 : total_word_count_ * 1.0 / documents_.size() };
+}
+
+vector<string_view> SearchServer::ExpandPrefix(string_view prefix) const {
+    vector<string_view> words;
+    for (auto it = word_to_term_id_.lower_bound(prefix); it != word_to_term_id_.end() && words.size() < MAX_WILDCARD_EXPANSION; ++it) {
+        if (it->first.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        // Words of removed documents stay in the dictionary with empty posting lists
+        if (!word_to_document_freqs_.at(it->first).empty()) {
+            words.push_back(it->first);
+        }
+    }
+    return words;
+}
+
+// The sorted dictionary is walked as a trie: words sharing a prefix with the previous word
+// reuse its rows of the Levenshtein table, and once every cell of a row exceeds the distance
+// all words with this prefix are skipped with a single seek
+vector<pair<string_view, int>> SearchServer::ExpandFuzzyWord(const FuzzyWord& fuzzy_word) const {
+    const string_view query_word = fuzzy_word.word;
+    const size_t width = query_word.size() + 1;
+    // Row i holds distances between the first i letters of the dictionary word and every prefix of the query word
+    vector<int> rows(width);
+    iota(rows.begin(), rows.end(), 0);
+
+    vector<pair<string_view, int>> result;
+    string_view previous_word;
+    auto it = word_to_term_id_.begin();
+    while (it != word_to_term_id_.end()) {
+        const string_view word = it->first;
+        const size_t valid_rows = rows.size() / width;
+        size_t depth = mismatch(word.begin(), word.begin() + min(word.size(), previous_word.size()), previous_word.begin()).first - word.begin();
+        depth = min(depth, valid_rows - 1);
+        rows.resize((depth + 1) * width);
+        previous_word = word;
+
+        bool is_pruned = false;
+        for (; depth < word.size(); ++depth) {
+            rows.resize(rows.size() + width);
+            const int* previous_row = rows.data() + depth * width;
+            int* row = rows.data() + (depth + 1) * width;
+            row[0] = static_cast<int>(depth + 1);
+            int row_min = row[0];
+            for (size_t j = 1; j < width; ++j) {
+                row[j] = min({ previous_row[j] + 1, row[j - 1] + 1, previous_row[j - 1] + (query_word[j - 1] == word[depth] ? 0 : 1) });
+                row_min = min(row_min, row[j]);
+            }
+            if (row_min > fuzzy_word.max_distance) {
+                is_pruned = true;
+                break;
+            }
+        }
+
+        if (is_pruned) {
+            // The next candidate is the first word which does not start with word[0, depth]
+            string successor(word.substr(0, depth + 1));
+            while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xFF) {
+                successor.pop_back();
+            }
+            if (successor.empty()) {
+                break;
+            }
+            successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+            it = word_to_term_id_.lower_bound(successor);
+            continue;
+        }
+        const int distance = rows.back();
+        if (distance <= fuzzy_word.max_distance && !word_to_document_freqs_.at(word).empty()) {
+            result.push_back({ word, distance });
+        }
+        ++it;
+    }
+
+    if (result.size() > MAX_WILDCARD_EXPANSION) {
+        stable_sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second < rhs.second;
+            });
+        result.resize(MAX_WILDCARD_EXPANSION);
+    }
+    return result;
+}
+
+vector<pair<int, double>> SearchServer::MergePostings(const vector<string_view>& words) const {
+    using PostingIterator = Postings::const_iterator;
+    vector<pair<PostingIterator, PostingIterator>> cursors;
+    size_t total_size = 0;
+    for (const auto word : words) {
+        const auto& postings = word_to_document_freqs_.at(word);
+        cursors.push_back({ postings.begin(), postings.end() });
+        total_size += postings.size();
+    }
+    SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, total_size);
+
+    // K-way merge with a heap of cursors ordered by their current document id
+    auto greater_document_id = [](const auto& lhs, const auto& rhs) {
+        return lhs.first->first > rhs.first->first;
+    };
+    make_heap(cursors.begin(), cursors.end(), greater_document_id);
+    vector<pair<int, double>> result;
+    result.reserve(total_size);
+    while (!cursors.empty()) {
+        pop_heap(cursors.begin(), cursors.end(), greater_document_id);
+        auto& cursor = cursors.back();
+        const auto [document_id, term_freq] = *cursor.first;
+        if (!result.empty() && result.back().first == document_id) {
+            result.back().second += term_freq;
+        }
+        else {
+            result.push_back({ document_id, term_freq });
+        }
+        if (++cursor.first == cursor.second) {
+            cursors.pop_back();
+        }
+        else {
+            push_heap(cursors.begin(), cursors.end(), greater_document_id);
+        }
+    }
+    return result;
 }
\ No newline at end of file
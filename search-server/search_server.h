@@ -1,6 +1,10 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory_resource>
 #include <set>
 #include <vector>
 #include <string>
@@ -8,198 +12,1491 @@
 #include <cmath>
 #include <stdexcept>
 #include <numeric>
+#include <exception>
 #include <execution>
 #include <future>
+#include <optional>
+#include <limits>
+#include <memory>
+#include <mutex>
 
 #include "document.h"
+#include "document_filter.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "paginator.h"
+#include "sorted_intersection.h"
+#include "search_metrics.h"
+#include "scorer.h"
+#include "stop_word_set.h"
 
 using namespace std;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double ACCURACY = 1e-6;
+const size_t MAX_WILDCARD_EXPANSION = 64; // terms a single prefix* or word~N query word expands to
+const int MAX_EDIT_DISTANCE = 2; // largest N of a fuzzy word~N
+const size_t IMPACT_REQUANTIZATION_RATIO = 8;
+const size_t POSTING_TIER_SIZE = 64; // postings with the largest tf kept in the first tier of a word
+const size_t MAX_TIERED_QUERY_WORDS = 2; // longer queries always scan whole posting lists
+const size_t HOT_TERM_TOP_SIZE = 32; // postings of every status cached for a hot word
+const size_t HOT_TERM_MIN_DOCUMENTS = 256; // words in fewer documents are scanned, not cached
+const size_t BUDGET_CLOCK_INTERVAL = 256; // postings scanned between deadline checks of a query with time_budget
 const int MAX_THREAD = 100; //  -  
 
+struct SearchServerOptions {
+    // Keeps word positions of every document, it is required for "quoted phrase" queries.
+    // Without it a quote is a character of an ordinary query word
+    bool store_positions = false;
+    // Keeps a separate copy of the posting lists for every status, so a search by status
+    // scans only the documents with this status at the cost of twice the posting memory
+    bool partition_by_status = false;
+    // Keeps a copy of the posting lists with tf * idf quantized to 16 bits for QuantizedTfIdfScorer.
+    // Impacts are requantized after every IMPACT_REQUANTIZATION_RATIO-th part of the documents changes
+    bool quantize_impacts = false;
+    // Allocates the nodes of all internal maps and sets, nullptr means the default resource.
+    // It must outlive the server; RemoveDocument with a parallel policy frees nodes from
+    // several threads, so an unsynchronized pool may be used only with sequential calls
+    pmr::memory_resource* memory_resource = nullptr;
+    // Keeps the POSTING_TIER_SIZE postings with the largest tf of every word apart, so TF-IDF
+    // queries of up to MAX_TIERED_QUERY_WORDS plus words read only the tiers when the rest
+    // of the postings provably cannot reach the requested page. Results are the same
+    bool tiered_postings = false;
+    // Caches the HOT_TERM_TOP_SIZE postings with the largest tf of every status for this many
+    // most queried words, so a single-word TF-IDF query by status reads only the cache when
+    // the rest of the postings provably cannot reach the requested page. Results are the same
+    size_t hot_term_count = 0;
+};
+
+// Words of a document split in advance, for example by a parallel loader. The words are
+// views of text, AddDocument copies the text once and moves the views onto the copy
+struct TokenizedDocument {
+    string_view text;
+    vector<string_view> words;
+    // Filled only when the server stores positions
+    vector<uint32_t> positions;
+};
+
+// ANY finds documents with at least one plus word, words marked with '+' are required
+// in both modes. ALL requires every plain plus word, prefix and fuzzy words stay optional
+enum class QueryMode {
+    ANY,
+    ALL,
+};
+
+// Page of ranked results: offset and limit are applied after search_after,
+// so a cursor alone walks the results without recomputing previous pages
+struct SearchOptions {
+    size_t offset = 0;
+    size_t limit = MAX_RESULT_DOCUMENT_COUNT;
+    optional<SearchCursor> search_after;
+    QueryMode mode = QueryMode::ANY;
+    // Anytime search: when the query has read this many postings or spent this time,
+    // the best documents found so far are returned as an approximate result. Zero means
+    // no limit. Queries with required words, prefixes or fuzzy words are never cut short
+    size_t max_postings = 0;
+    chrono::microseconds time_budget{ 0 };
+};
+
+struct SearchResult {
+    vector<Document> documents;
+    // Cursor of the last returned document, empty when there are no more results
+    optional<SearchCursor> next_cursor;
+    // The budget ran out before all postings were read, so documents may be missing
+    // and their relevance may be lower than the exact one
+    bool is_approximate = false;
+};
+
+// Result of a batch MatchDocuments call stored in flat arrays:
+// words of the i-th document are words[word_offsets[i], word_offsets[i + 1])
+struct MatchedDocuments {
+    vector<int> document_ids;
+    vector<DocumentStatus> statuses;
+    vector<size_t> word_offsets = { 0 };
+    vector<string_view> words;
+
+    size_t size() const {
+        return document_ids.size();
+    }
+
+    IteratorRange<vector<string_view>::const_iterator> GetWords(size_t index) const {
+        return { words.begin() + word_offsets[index], words.begin() + word_offsets[index + 1] };
+    }
+};
+
+// Estimated heap bytes of the server structures. Node sizes are computed for a typical
+// red-black tree and malloc, a pool memory resource changes the real numbers
+struct MemoryStats {
+    size_t inverted_index = 0;     // Word keys and postings
+    size_t status_partitions = 0;  // Same with partition_by_status
+    size_t forward_index = 0;      // Term ids and frequencies of every document
+    size_t positions = 0;          // Zero unless store_positions is set
+    size_t document_text = 0;      // Stored texts, words of the indexes point into them
+    size_t dictionary = 0;         // Term ids of the words
+    size_t stop_words = 0;
+    size_t documents = 0;          // Document data, id set and rating index
+    size_t impact_index = 0;       // Zero unless quantize_impacts is set
+    size_t posting_tiers = 0;      // Zero unless tiered_postings is set
+    size_t hot_terms = 0;          // Zero unless hot_term_count is set
+    size_t total = 0;
+};
+
+// Single-word queries by status of the words in HOT_TERM_MIN_DOCUMENTS or more documents:
+// hits are answered from the cache, misses scan the postings because the word is not cached
+// or its cached postings are not enough for the page
+struct HotTermStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t admissions = 0;
+    size_t evictions = 0;  // Words replaced by more often queried ones
+    size_t cached_terms = 0;
+};
+
+// TF-IDF queries which tried the posting tiers: hits are answered from the tiers alone,
+// fallbacks scan whole posting lists because the tiers could not prove the page
+struct TierStats {
+    size_t hits = 0;
+    size_t fallbacks = 0;
+};
+
+// Gaps between consecutive dense document numbers in the impact posting lists
+struct PostingGapStats {
+    size_t gap_count = 0;
+    double average_log2_gap = 0.0;
+    // Size of the postings if the gaps were varint encoded
+    size_t varint_bytes = 0;
+    // gap_bit_counts[b] is the number of gaps which need exactly b bits
+    array<size_t, 33> gap_bit_counts = {};
+};
+
+// Read-only view of the forward index entry of a document. Words are iterated
+// in the order of their term ids, the view is invalidated by AddDocument and RemoveDocument.
+class WordFrequencies {
+public:
+    class Iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = pair<string_view, double>;
+        using difference_type = ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(const vector<string_view>* term_id_to_word, const int* term_id, const double* freq)
+            : term_id_to_word_(term_id_to_word)
+            , term_id_(term_id)
+            , freq_(freq) {
+        }
+
+        value_type operator*() const {
+            return { (*term_id_to_word_)[*term_id_], *freq_ };
+        }
+
+        Iterator& operator++() {
+            ++term_id_;
+            ++freq_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return term_id_ == other.term_id_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return term_id_ != other.term_id_;
+        }
+
+    private:
+        const vector<string_view>* term_id_to_word_;
+        const int* term_id_;
+        const double* freq_;
+    };
+
+    WordFrequencies() = default;
+
+    WordFrequencies(const vector<string_view>* term_id_to_word, const int* term_ids, const double* freqs, size_t size)
+        : term_id_to_word_(term_id_to_word)
+        , term_ids_(term_ids)
+        , freqs_(freqs)
+        , size_(size) {
+    }
+
+    Iterator begin() const {
+        return { term_id_to_word_, term_ids_, freqs_ };
+    }
+
+    Iterator end() const {
+        return { term_id_to_word_, term_ids_ + size_, freqs_ + size_ };
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+private:
+    const vector<string_view>* term_id_to_word_ = nullptr;
+    const int* term_ids_ = nullptr;
+    const double* freqs_ = nullptr;
+    size_t size_ = 0;
+};
+
 class SearchServer {
 public:
+    using const_iterator = pmr::set<int>::const_iterator;
+
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
-    explicit SearchServer(const string& stop_words_text);
-    explicit SearchServer(string_view stop_words);
+    explicit SearchServer(const StringContainer& stop_words, const SearchServerOptions& options = {});
+    explicit SearchServer(const string& stop_words_text, const SearchServerOptions& options = {});
+    explicit SearchServer(string_view stop_words, const SearchServerOptions& options = {});
+    // Takes the perfect hash built at compile time instead of building it. The server views
+    // the words of the set, so they must outlive it, as string literals do
+    template <size_t WordCount>
+    explicit SearchServer(const StaticStopWordSet<WordCount>& stop_words, const SearchServerOptions& options = {});
 
     void AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings);
+    void AddDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const vector<int>& ratings);
+    // Splits the text into words without stop words, it is safe to call from several threads
+    TokenizedDocument TokenizeDocument(string_view text) const;
 
-    template <typename DocumentPredicate>
+    // Every overload takes the ranking function as an optional first template argument,
+    // e.g. FindTopDocuments<Bm25Scorer>(raw_query), see scorer.h.
+    // A DocumentFilter predicate is evaluated with the indexes, any other one is called for every posting
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
     vector<Document> FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename Scorer = TfIdfScorer>
     vector<Document> FindTopDocuments(string_view raw_query, DocumentStatus status) const;
+    template <typename Scorer = TfIdfScorer>
     vector<Document> FindTopDocuments(string_view raw_query) const;
 
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate, typename ExecutionPolicy>
     vector<Document> FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentPredicate document_predicate) const;
-    template <typename ExecutionPolicy>
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
     vector<Document> FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentStatus status) const;
-    template <typename ExecutionPolicy>
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
     vector<Document> FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query) const;
 
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
+    SearchResult FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate, const SearchOptions& options) const;
+    template <typename Scorer = TfIdfScorer>
+    SearchResult FindTopDocuments(string_view raw_query, DocumentStatus status, const SearchOptions& options) const;
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate, typename ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentPredicate document_predicate, const SearchOptions& options) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+    SearchResult FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentStatus status, const SearchOptions& options) const;
+
+    // Same results as FindTopDocuments(raw_query) for every query. Posting lists of the batch
+    // words are scanned once and shared, queries with prefix, fuzzy, required words or
+    // phrases are searched one by one. Throws the error of the first invalid query
+    template <typename ExecutionPolicy>
+    vector<vector<Document>> FindTopDocumentsBatch(ExecutionPolicy&& policy, const vector<string>& raw_queries) const;
+
     int GetDocumentCount() const;
+    // Bytes taken by word positions, zero unless store_positions is set
+    size_t GetPositionalIndexMemory() const;
+    // Computed from counters kept up to date by AddDocument and RemoveDocument, it takes
+    // constant time except for the stop words
+    MemoryStats GetMemoryStats() const;
+    HotTermStats GetHotTermStats() const;
+    // Counted in every build, unlike the tier counters of SearchMetrics
+    TierStats GetTierStats() const;
 
-    set<int>::const_iterator begin() const;
-    set<int>::const_iterator end() const;
-    const map<string_view, double>& GetWordFrequencies(int document_id) const;
+    // Renumbers the documents of the impact index by recursive graph bisection, so that documents
+    // with common words get close dense numbers. Document ids do not change, documents added later
+    // are numbered after the reordered ones. Throws logic_error without quantize_impacts
+    void ReorderDocuments();
+    PostingGapStats GetPostingGapStats() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    WordFrequencies GetWordFrequencies(int document_id) const;
     
     template <typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy&& policy, int document_id);
     void RemoveDocument(int document_id);
+    // Throws out_of_range if there is no such document
+    void SetDocumentStatus(int document_id, DocumentStatus status);
 
     tuple<vector<string_view>, DocumentStatus> MatchDocument(string_view raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const execution::sequenced_policy&, string_view raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const execution::parallel_policy&, string_view raw_query, int document_id) const;
+
+    // Parses the query once and matches it against every document of the range
+    template <typename DocumentIdRange>
+    MatchedDocuments MatchDocuments(string_view raw_query, const DocumentIdRange& document_ids) const;
+    template <typename ExecutionPolicy, typename DocumentIdRange>
+    MatchedDocuments MatchDocuments(ExecutionPolicy&& policy, string_view raw_query, const DocumentIdRange& document_ids) const;
   
     
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        // Position of the document terms in the forward index arrays
+        size_t forward_offset = 0;
+        size_t forward_size = 0;
+        // Number of words without stop words
+        int word_count = 0;
+        // Dense number of the document in the impact index
+        uint32_t impact_number = 0;
+    };
+    // Postings ordered by the dense document numbers
+    struct ImpactPostings {
+        vector<uint32_t> document_numbers;
+        vector<uint16_t> impacts;
     };
     struct QueryWord {
         string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
+        // Positive for a fuzzy word~N
+        int max_distance;
+        // Marked with '+', only plain words can be required
+        bool is_required = false;
+    };
+    struct FuzzyWord {
+        string_view word;
+        int max_distance;
+    };
+    // Words of a quoted phrase with their offsets in the phrase, stop words only shift offsets
+    struct Phrase {
+        vector<string_view> words;
+        vector<uint32_t> offsets;
     };
     struct Query {
         vector<string_view> plus_words;
+        // Plus words which every found document must contain, they are also in plus_words
+        vector<string_view> required_words;
         vector<string_view> minus_words;
+        // Prefixes of trailing wildcard words without the '*'
+        vector<string_view> plus_prefixes;
+        vector<string_view> minus_prefixes;
+        vector<FuzzyWord> plus_fuzzy_words;
+        vector<FuzzyWord> minus_fuzzy_words;
+        vector<Phrase> phrases;
+    };
+    struct ResolvedPhrase {
+        vector<int> term_ids;
+        vector<uint32_t> offsets;
+    };
+    // Query words resolved to sorted unique term ids, unknown words are dropped
+    struct ResolvedQuery {
+        vector<int> plus_term_ids;
+        vector<int> minus_term_ids;
+        vector<int> required_term_ids;
+        vector<ResolvedPhrase> phrases;
+        // Some required word is not indexed, so nothing can match
+        bool has_unknown_required = false;
+        // Some phrase contains a word which is not indexed, so nothing can match
+        bool has_unknown_phrase = false;
+    };
+
+    using Postings = pmr::map<int, double>;
+    using WordIndex = pmr::map<string_view, Postings>;
+    // Postings of a word with the largest tf: a min-heap of (term_freq, document_id). Postings
+    // outside the tier have tf not above tail_max_term_freq, which is zero when there are none
+    struct PostingTier {
+        vector<pair<double, int>> postings;
+        double tail_max_term_freq = 0.0;
+
+        // Keeps at most capacity postings
+        void Add(size_t capacity, int document_id, double term_freq);
+        // Returns false for a posting of the tail, tail_max_term_freq stays an upper bound
+        bool Erase(int document_id, double term_freq);
+        // Fills the tier from all postings of the word
+        void Assign(size_t capacity, vector<pair<double, int>> all_postings);
+    };
+    struct HotTerm {
+        array<PostingTier, DOCUMENT_STATUS_COUNT> tiers;
+        size_t query_count = 0;
+    };
+    // Query threads change the cache under the mutex, so it does not use memory_resource_
+    struct HotTermCache {
+        mutex access;
+        map<string_view, HotTerm> terms;
+        // Single-word queries of the words which are not cached
+        map<string_view, size_t> query_counts;
+        HotTermStats stats;
     };
+    // Queries of several threads count into it at once
+    struct TierCounters {
+        atomic<size_t> hits{ 0 };
+        atomic<size_t> fallbacks{ 0 };
+    };
+    // Posting of an ACTUAL document with the word relevance, used by FindTopDocumentsBatch
+    struct ScoredPosting {
+        int document_id;
+        int rating;
+        double relevance;
+    };
+    static array<WordIndex, DOCUMENT_STATUS_COUNT> MakeStatusIndexes(pmr::memory_resource* memory_resource);
 
     const set<string> stop_words_;
-    map<string_view, map<int, double>> word_to_document_freqs_;
-    map<int, DocumentData> documents_;
-    set<int> document_ids_;
-    map<int, map<string_view, double>> document_to_word_freqs_;
-    set<string, less<>> all_words_;
+    // Membership tests of stop_words_ during ingestion and query parsing
+    const StopWordSet stop_word_table_;
+    const SearchServerOptions options_;
+    pmr::memory_resource* const memory_resource_;
+    WordIndex word_to_document_freqs_;
+    // Same posting lists split by the document status, filled only with partition_by_status
+    array<WordIndex, DOCUMENT_STATUS_COUNT> status_word_to_document_freqs_;
+    pmr::map<int, DocumentData> documents_;
+    pmr::set<int> document_ids_;
+    pmr::set<pmr::string, less<>> all_words_;
+    pmr::map<string_view, int> word_to_term_id_;
+    vector<string_view> term_id_to_word_;
+    // Forward index in CSR layout: terms of a document are sorted by id and
+    // occupy [forward_offset, forward_offset + forward_size) of both arrays
+    vector<int> forward_term_ids_;
+    vector<double> forward_freqs_;
+    // Entries of removed documents which are still kept in the forward index arrays
+    size_t forward_garbage_ = 0;
+    // Sum of word_count of all documents
+    size_t total_word_count_ = 0;
+    // Counters for GetMemoryStats: entries of word_to_document_freqs_ postings,
+    // heap bytes of the all_words_ strings and entries of word_to_impacts_ postings
+    size_t posting_count_ = 0;
+    size_t document_text_bytes_ = 0;
+    size_t impact_posting_count_ = 0;
+    size_t tier_posting_count_ = 0;
+    // Pairs of rating and id of all documents
+    pmr::set<pair<int, int>> rating_document_ids_;
+    // Impact index: impact * impact_scale_ approximates tf * idf. Dense numbers of removed
+    // documents keep their postings with the id -1 until the next requantization
+    pmr::map<string_view, ImpactPostings> word_to_impacts_;
+    vector<int> impact_document_ids_;
+    pmr::map<string_view, PostingTier> word_to_tiers_;
+    // Created only with tiered_postings
+    unique_ptr<TierCounters> tier_counters_;
+    // Created only with hot_term_count
+    unique_ptr<HotTermCache> hot_terms_;
+    // Order of the dense numbers chosen by ReorderDocuments, empty for the order of ids
+    vector<int> reordered_document_ids_;
+    double impact_scale_ = 1.0;
+    size_t impact_changes_ = 0;
+    // Positional index: positions of the i-th forward index entry are delta and varint
+    // encoded in position_bytes_ from forward_position_offsets_[i] up to the next entry
+    vector<size_t> forward_position_offsets_;
+    vector<uint8_t> position_bytes_;
 
+    string_view StoreDocumentText(string_view text);
     bool IsStopWord(string_view word) const;
     static bool IsValidWord(string_view word);
-    vector<string_view> SplitIntoWordsNoStop(string_view text) const;
+    // Without stop_word_table the table is built over the strings of stop_words
+    SearchServer(set<string> stop_words, optional<StopWordSet> stop_word_table, const SearchServerOptions& options);
+    // Positions are indexes of the words among all words of the text including stop words
+    vector<string_view> SplitIntoWordsNoStop(string_view text, vector<uint32_t>* positions = nullptr) const;
+    // Words must be views of the text stored in all_words_
+    void IndexDocument(int document_id, const vector<string_view>& words, const vector<uint32_t>& positions, DocumentStatus status,
+        const vector<int>& ratings);
     static int ComputeAverageRating(const vector<int>& ratings);
     QueryWord ParseQueryWord(string_view text) const;
     Query ParseQuery(string_view text, bool is_seq) const;
+    // Parses the phrase starting at words[first] and returns the index of its last word
+    size_t ParsePhrase(const vector<string_view>& words, size_t first, Query& query) const;
+    // Relevance within ACCURACY is a tie broken by rating and then by id
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
+    template <typename ExecutionPolicy>
+    static SearchResult SelectPage(ExecutionPolicy&& policy, vector<Document> matched_documents, const SearchOptions& options);
+
+    int GetOrAddTermId(string_view word);
+    void EraseDocumentData(int document_id);
+    void CountTierQuery(bool is_hit) const;
+    void AddTierPosting(string_view word, int document_id, double term_freq);
+    // The tier is refilled from the posting list when removals leave it half empty
+    void EraseTierPosting(string_view word, int document_id, double term_freq);
+    void RebuildTier(string_view word);
+    void EraseHotTermPosting(string_view word, DocumentStatus status, int document_id, double term_freq);
+    // Refills the tier of the status from the posting list
+    void RebuildHotTier(string_view word, DocumentStatus status, PostingTier& tier) const;
+    // Caches the word unless every cached word is queried at least as often, returns the cached word or nullptr
+    HotTerm* AdmitHotTerm(HotTermCache& cache, string_view word, size_t query_count) const;
+    void CompactForwardIndex();
+    ResolvedQuery ResolveQuery(const Query& query) const;
+    // Returns false when some phrase word is not indexed
+    bool ResolvePhrases(const vector<Phrase>& phrases, vector<ResolvedPhrase>& resolved_phrases) const;
+    vector<uint32_t> DecodePositions(size_t forward_index) const;
+    bool MatchesPhrase(const DocumentData& document_data, const ResolvedPhrase& phrase) const;
+    // Appends matched words of the document to the output, existence required
+    DocumentStatus MatchResolvedQuery(const ResolvedQuery& query, int document_id, vector<string_view>& matched_words) const;
     // Existence required
-    double ComputeWordInverseDocumentFreq(string_view word) const;
+    CorpusStats GetCorpusStats() const;
+    uint16_t QuantizeImpact(double impact) const;
+    void AddDocumentImpacts(int document_id);
+    void RequantizeImpacts();
+    template <typename DocumentPredicate>
+    vector<Document> FindAllDocumentsByImpacts(const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy>
+    void FilterPhrases(ExecutionPolicy&& policy, const Query& query, vector<Document>& matched_documents) const;
+    // Indexed words starting with the prefix, at most MAX_WILDCARD_EXPANSION in lexicographic order
+    vector<string_view> ExpandPrefix(string_view prefix) const;
+    // Union of the posting lists of the words with summed term frequencies, ordered by document id
+    vector<pair<int, double>> MergePostings(const vector<string_view>& words) const;
+    // Indexed words within the edit distance with their distances, at most MAX_WILDCARD_EXPANSION closest ones
+    vector<pair<string_view, int>> ExpandFuzzyWord(const FuzzyWord& fuzzy_word) const;
+
+    // DocumentFilter prepared for a query: candidates are the sorted ids of the documents
+    // in the rating range when there are much fewer of them than postings to scan
+    struct FilterPlan {
+        const DocumentFilter* filter = nullptr;
+        optional<vector<int>> candidates;
 
-    template <typename DocumentPredicate, class ExecutionPolicy>
-    vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const;
+        bool operator()(int document_id, DocumentStatus status, int rating) const {
+            return (*filter)(document_id, status, rating);
+        }
+    };
+    FilterPlan PlanFilter(const DocumentFilter& filter, const Query& query) const;
+
+    static Postings::const_iterator PostingLowerBound(const Postings& postings, int document_id);
+    static vector<pair<int, double>>::const_iterator PostingLowerBound(const vector<pair<int, double>>& postings, int document_id);
+    // Calls visit(document_id, term_freq, document_data) for the postings accepted by the predicate
+    template <typename PostingList, typename DocumentPredicate, typename Visitor>
+    void ScanPostings(const PostingList& postings, const DocumentPredicate& document_predicate, Visitor visit) const;
+    template <typename PostingList, typename Visitor>
+    void ScanPostings(const PostingList& postings, const FilterPlan& plan, Visitor visit) const;
+
+    // Posting lists of the indexed words in the order of the words, absent words are dropped.
+    // Disjunctive scans add up the words in this order, so the relevance does not depend on the planner
+    static vector<pair<string_view, const Postings*>> FindPostings(const vector<string_view>& words, const WordIndex& scanned_index);
+    // Query planner: posting lists of the indexed words ordered from the shortest, absent words are dropped
+    static vector<pair<string_view, const Postings*>> PlanPostings(const vector<string_view>& words, const WordIndex& scanned_index);
+    // Moves a cursor forward to the first posting not less than document_id
+    static Postings::const_iterator SeekPosting(const Postings& postings, Postings::const_iterator it, int document_id);
+    // Leapfrog intersection of the required words starting from the rarest one, the other
+    // words only add relevance to the documents of the intersection
+    template <typename Scorer, typename DocumentPredicate>
+    vector<Document> FindConjunctiveDocuments(const Query& query, const DocumentPredicate& document_predicate, const WordIndex& scanned_index) const;
+
+    // Top documents of a single-word TF-IDF query by status from the hot term cache, nullopt
+    // when the query has another form or the cache cannot prove the order of the first top_count
+    // documents. Otherwise the result holds more than top_count documents including all of them
+    optional<vector<Document>> FindTopDocumentsByHotTerm(const Query& query, const DocumentFilter& filter, size_t top_count) const;
+
+    // Top documents of a short TF-IDF query computed from the word tiers: nullopt when the query
+    // needs other words, or when a document outside the tiers might rank among the first
+    // top_count ones. Otherwise the result holds more than top_count documents including all of them
+    template <typename DocumentPredicate>
+    optional<vector<Document>> FindTopDocumentsByTiers(const Query& query, const DocumentPredicate& document_predicate, size_t top_count) const;
+
+    // Postings and time left to an anytime query, the clock is read every BUDGET_CLOCK_INTERVAL postings
+    struct QueryBudget {
+        size_t postings_left = numeric_limits<size_t>::max();
+        optional<chrono::steady_clock::time_point> deadline;
+        size_t postings_to_clock = BUDGET_CLOCK_INTERVAL;
+        bool is_exhausted = false;
+
+        explicit QueryBudget(const SearchOptions& options) {
+            if (options.max_postings > 0) {
+                postings_left = options.max_postings;
+            }
+            if (options.time_budget.count() > 0) {
+                deadline = chrono::steady_clock::now() + options.time_budget;
+            }
+        }
+
+        bool IsLimited() const {
+            return postings_left != numeric_limits<size_t>::max() || deadline;
+        }
+
+        // Takes one posting from the budget, false once it has run out
+        bool Spend() {
+            if (is_exhausted || postings_left == 0) {
+                is_exhausted = true;
+                return false;
+            }
+            --postings_left;
+            if (deadline && --postings_to_clock == 0) {
+                postings_to_clock = BUDGET_CLOCK_INTERVAL;
+                is_exhausted = chrono::steady_clock::now() >= *deadline;
+            }
+            return !is_exhausted;
+        }
+    };
+    // Sequential scan of the plain words which stops when the budget runs out. Words go from
+    // the rarest one, whose postings have the largest idf, and the tier of a word, if kept,
+    // goes before its other postings, so a cut scan has read the largest impacts first
+    template <typename Scorer, typename DocumentPredicate>
+    vector<Document> FindAllDocumentsWithinBudget(const Query& query, const DocumentPredicate& document_predicate,
+        const WordIndex& scanned_index, QueryBudget& budget) const;
+    // FindTopDocuments of a parsed query, the budget is started before the query was parsed
+    template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
+    SearchResult FindTopDocumentsByQuery(ExecutionPolicy&& policy, Query query, DocumentPredicate document_predicate,
+        const SearchOptions& options, QueryBudget budget) const;
+
+    // offset + limit saturated at the largest size_t, which means the page has no end
+    static size_t GetPageEnd(const SearchOptions& options);
+
+    // Scored documents of a page: documents ranked at or before search_after are dropped as they
+    // come, and only the offset + limit + 1 best of the rest are kept, the extra one tells SelectPage
+    // that there is a next page. Unbounded ones keep every document after the cursor, phrase
+    // filtering may still drop any of them
+    struct PageCandidates {
+        optional<Document> cursor;
+        size_t capacity = numeric_limits<size_t>::max();
+        // A heap with the last ranked document on top once capacity is reached
+        vector<Document> documents;
+
+        PageCandidates(const SearchOptions& options, bool is_bounded) {
+            if (options.search_after) {
+                cursor = Document(options.search_after->id, options.search_after->relevance, options.search_after->rating);
+            }
+            // Pages reaching the largest size_t are not bounded
+            if (const size_t page_end = GetPageEnd(options); is_bounded && page_end < capacity) {
+                capacity = page_end + 1;
+            }
+        }
+
+        void Add(const Document& document) {
+            if (cursor && !IsRankedBefore(*cursor, document)) {
+                return;
+            }
+            if (documents.size() < capacity) {
+                documents.push_back(document);
+                if (documents.size() == capacity) {
+                    make_heap(documents.begin(), documents.end(), IsRankedBefore);
+                }
+            }
+            else if (IsRankedBefore(document, documents.front())) {
+                pop_heap(documents.begin(), documents.end(), IsRankedBefore);
+                documents.back() = document;
+                push_heap(documents.begin(), documents.end(), IsRankedBefore);
+            }
+        }
+    };
+    static vector<Document> SelectPageCandidates(vector<Document> documents, const SearchOptions& options, bool is_bounded);
+
+    // Only postings of scanned_index are visited, document frequencies always come from the whole index.
+    // Documents which cannot reach the page of options are not returned
+    template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
+    vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+        const WordIndex& scanned_index, const SearchOptions& options) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
-    {
-        if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
-            throw invalid_argument("Some of stop words are invalid"s);
-        }
-    }
+SearchServer::SearchServer(const StringContainer& stop_words, const SearchServerOptions& options)
+    : SearchServer(MakeUniqueNonEmptyStrings(stop_words), nullopt, options)  // Extract non-empty stop words
+{
+}
+
+template <size_t WordCount>
+SearchServer::SearchServer(const StaticStopWordSet<WordCount>& stop_words, const SearchServerOptions& options)
+    : SearchServer(MakeUniqueNonEmptyStrings(stop_words.GetSlots()), StopWordSet(stop_words), options)
+{
+}
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
 vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query, true);
+    return FindTopDocuments<Scorer>(policy, raw_query, document_predicate, SearchOptions{}).documents;
+}
+
+template <typename Scorer, typename DocumentPredicate>
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<Scorer>(execution::seq, raw_query, document_predicate);
+}
+
+template <typename Scorer>
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Scorer>(execution::seq, raw_query, status);
+}
+
+template <typename Scorer>
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments<Scorer>(execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename Scorer, typename ExecutionPolicy>
+vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Scorer>(policy, raw_query, status, SearchOptions{}).documents;
+}
+template <typename Scorer, typename ExecutionPolicy>
+vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query) const {
+    return FindTopDocuments<Scorer>(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Scorer, typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate, const SearchOptions& options) const {
+    return FindTopDocuments<Scorer>(execution::seq, raw_query, document_predicate, options);
+}
+
+template <typename Scorer>
+SearchResult SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocuments<Scorer>(execution::seq, raw_query, status, options);
+}
 
-    sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < ACCURACY) {
-            return lhs.rating > rhs.rating;
+template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentPredicate document_predicate, const SearchOptions& options) const {
+    QueryBudget budget(options);
+    return FindTopDocumentsByQuery<Scorer>(policy, ParseQuery(raw_query, true), document_predicate, options, budget);
+}
+
+template <typename Scorer, typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocuments<Scorer>(policy, raw_query, DocumentFilter().SetStatuses({ status }), options);
+}
+
+template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocumentsByQuery(ExecutionPolicy&& policy, Query query, DocumentPredicate document_predicate,
+    const SearchOptions& options, QueryBudget budget) const {
+    if (options.mode == QueryMode::ALL) {
+        query.required_words = query.plus_words;
+    }
+    if constexpr (is_same_v<Scorer, TfIdfScorer>) {
+        if constexpr (is_same_v<decay_t<DocumentPredicate>, DocumentFilter>) {
+            if (hot_terms_ && !options.search_after) {
+                if (auto matched_documents = FindTopDocumentsByHotTerm(query, document_predicate, GetPageEnd(options))) {
+                    return SelectPage(policy, move(*matched_documents), options);
+                }
+            }
         }
-        else {
-            return lhs.relevance > rhs.relevance;
+        if (options_.tiered_postings && !options.search_after) {
+            if (auto matched_documents = FindTopDocumentsByTiers(query, document_predicate, GetPageEnd(options))) {
+                return SelectPage(policy, move(*matched_documents), options);
+            }
+        }
+    }
+
+    auto find_page = [&](const auto& predicate, const WordIndex& scanned_index) {
+        if constexpr (!is_same_v<Scorer, QuantizedTfIdfScorer>) {
+            if (budget.IsLimited() && query.required_words.empty() && query.plus_prefixes.empty() && query.minus_prefixes.empty()
+                && query.plus_fuzzy_words.empty() && query.minus_fuzzy_words.empty()) {
+                SearchResult result = SelectPage(policy, FindAllDocumentsWithinBudget<Scorer>(query, predicate, scanned_index, budget), options);
+                result.is_approximate = budget.is_exhausted;
+                if (budget.is_exhausted) {
+                    SEARCH_COUNT(SearchCounter::BUDGET_EXHAUSTED, 1);
+                }
+                return result;
+            }
+        }
+        return SelectPage(policy, FindAllDocuments<Scorer>(policy, query, predicate, scanned_index, options), options);
+    };
+    if constexpr (is_same_v<decay_t<DocumentPredicate>, DocumentFilter>) {
+        const auto status = document_predicate.GetSingleStatus();
+        const auto& scanned_index = options_.partition_by_status && status ? status_word_to_document_freqs_[static_cast<int>(*status)] : word_to_document_freqs_;
+        return find_page(PlanFilter(document_predicate, query), scanned_index);
+    }
+    else {
+        return find_page(document_predicate, word_to_document_freqs_);
+    }
+}
+
+template <typename ExecutionPolicy>
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(ExecutionPolicy&& policy, const vector<string>& raw_queries) const {
+    // An exception must not leave a parallel algorithm, so the first invalid query is rethrown after it
+    vector<Query> queries(raw_queries.size());
+    vector<exception_ptr> parse_errors(raw_queries.size());
+    vector<size_t> query_indexes(queries.size());
+    iota(query_indexes.begin(), query_indexes.end(), 0);
+    for_each(policy, query_indexes.begin(), query_indexes.end(), [&](size_t i) {
+        try {
+            queries[i] = ParseQuery(raw_queries[i], true);
+        }
+        catch (...) {
+            parse_errors[i] = current_exception();
         }
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    for (const exception_ptr& parse_error : parse_errors) {
+        if (parse_error) {
+            rethrow_exception(parse_error);
+        }
     }
+    auto is_shared = [](const Query& query) {
+        return query.plus_prefixes.empty() && query.minus_prefixes.empty() && query.plus_fuzzy_words.empty()
+            && query.minus_fuzzy_words.empty() && query.required_words.empty() && query.phrases.empty();
+    };
 
-    return matched_documents;
+    vector<string_view> words;
+    for (const Query& query : queries) {
+        if (is_shared(query)) {
+            words.insert(words.end(), query.plus_words.begin(), query.plus_words.end());
+            words.insert(words.end(), query.minus_words.begin(), query.minus_words.end());
+        }
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    auto find_word = [&words](string_view word) {
+        return lower_bound(words.begin(), words.end(), word) - words.begin();
+    };
+
+    // Every posting list is read once: documents are filtered and scored here, so queries
+    // only merge flat arrays
+    const auto& scanned_index = options_.partition_by_status ? status_word_to_document_freqs_[static_cast<int>(DocumentStatus::ACTUAL)]
+        : word_to_document_freqs_;
+    const TfIdfScorer scorer;
+    const CorpusStats corpus_stats = GetCorpusStats();
+    vector<vector<ScoredPosting>> word_postings(words.size());
+    vector<size_t> word_indexes(words.size());
+    iota(word_indexes.begin(), word_indexes.end(), 0);
+    for_each(policy, word_indexes.begin(), word_indexes.end(), [&](size_t i) {
+        const auto postings = scanned_index.find(words[i]);
+        if (postings == scanned_index.end() || postings->second.empty()) {
+            return;
+        }
+        SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings->second.size());
+        const auto word_scorer = scorer.ForWord(corpus_stats, word_to_document_freqs_.at(words[i]).size());
+        word_postings[i].reserve(postings->second.size());
+        for (const auto& [document_id, term_freq] : postings->second) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_data.status == DocumentStatus::ACTUAL) {
+                word_postings[i].push_back({ document_id, document_data.rating, word_scorer(term_freq, document_data.word_count) });
+            }
+        }
+        });
+
+    vector<vector<Document>> result(queries.size());
+    for_each(policy, query_indexes.begin(), query_indexes.end(), [&](size_t i) {
+        SEARCH_STAGE(SearchStage::QUERY);
+        const Query& query = queries[i];
+        if (!is_shared(query)) {
+            // The same search as FindTopDocuments(raw_queries[i]) without parsing the query again
+            const SearchOptions options;
+            result[i] = FindTopDocumentsByQuery<TfIdfScorer>(execution::seq, move(queries[i]),
+                DocumentFilter().SetStatuses({ DocumentStatus::ACTUAL }), options, QueryBudget(options)).documents;
+            return;
+        }
+
+        // Words are added in the order of FindAllDocuments, so the relevance is the same to the last bit
+        const auto plan = FindPostings(query.plus_words, scanned_index);
+        vector<ScoredPosting> accumulator;
+        vector<ScoredPosting> merged;
+        for (auto word = plan.begin(); word != plan.end(); ++word) {
+            const auto& postings = word_postings[find_word(word->first)];
+            merged.clear();
+            merged.reserve(accumulator.size() + postings.size());
+            auto lhs = accumulator.begin();
+            auto rhs = postings.begin();
+            while (lhs != accumulator.end() || rhs != postings.end()) {
+                if (rhs == postings.end() || (lhs != accumulator.end() && lhs->document_id < rhs->document_id)) {
+                    merged.push_back(*lhs++);
+                }
+                else if (lhs == accumulator.end() || rhs->document_id < lhs->document_id) {
+                    merged.push_back(*rhs++);
+                }
+                else {
+                    merged.push_back({ lhs->document_id, lhs->rating, lhs->relevance + rhs->relevance });
+                    ++lhs;
+                    ++rhs;
+                }
+            }
+            swap(accumulator, merged);
+        }
+        for (const auto word : query.minus_words) {
+            const auto& postings = word_postings[find_word(word)];
+            auto minus = postings.begin();
+            const auto last = remove_if(accumulator.begin(), accumulator.end(), [&](const ScoredPosting& posting) {
+                while (minus != postings.end() && minus->document_id < posting.document_id) {
+                    ++minus;
+                }
+                return minus != postings.end() && minus->document_id == posting.document_id;
+                });
+            accumulator.erase(last, accumulator.end());
+        }
+
+        vector<Document> matched_documents;
+        matched_documents.reserve(accumulator.size());
+        for (const auto& posting : accumulator) {
+            matched_documents.push_back({ posting.document_id, posting.relevance, posting.rating });
+        }
+        SEARCH_COUNT(SearchCounter::CANDIDATES_SCORED, matched_documents.size());
+        result[i] = SelectPage(execution::seq, move(matched_documents), {}).documents;
+        });
+    return result;
 }
 
-template <typename DocumentPredicate>
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(execution::seq, raw_query, document_predicate);
+template <typename PostingList, typename DocumentPredicate, typename Visitor>
+void SearchServer::ScanPostings(const PostingList& postings, const DocumentPredicate& document_predicate, Visitor visit) const {
+    for (const auto& [document_id, term_freq] : postings) {
+        const auto& document_data = documents_.at(document_id);
+        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+            visit(document_id, term_freq, document_data);
+        }
+    }
 }
 
-template <typename ExecutionPolicy>
-vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+template <typename PostingList, typename Visitor>
+void SearchServer::ScanPostings(const PostingList& postings, const FilterPlan& plan, Visitor visit) const {
+    const DocumentFilter& filter = *plan.filter;
+    auto visit_accepted = [this, &filter, &visit](int document_id, double term_freq) {
+        const auto& document_data = documents_.at(document_id);
+        if (filter(document_id, document_data.status, document_data.rating)) {
+            visit(document_id, term_freq, document_data);
+        }
+    };
+
+    if (plan.candidates) {
+        // Pre-intersection: the postings are probed with the few documents in the rating range
+        for (const int document_id : *plan.candidates) {
+            const auto it = PostingLowerBound(postings, document_id);
+            if (it != postings.end() && it->first == document_id) {
+                visit_accepted(document_id, it->second);
+            }
+        }
+        return;
+    }
+    // Postings are ordered by id, so the id range is a subrange of them
+    for (auto it = PostingLowerBound(postings, filter.GetMinId()); it != postings.end() && it->first <= filter.GetMaxId(); ++it) {
+        visit_accepted(it->first, it->second);
+    }
 }
+
 template <typename ExecutionPolicy>
-vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, string_view raw_query) const {
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+SearchResult SearchServer::SelectPage(ExecutionPolicy&& policy, vector<Document> matched_documents, const SearchOptions& options) {
+    SEARCH_STAGE(SearchStage::TOP_K);
+    if (options.search_after) {
+        const Document cursor(options.search_after->id, options.search_after->relevance, options.search_after->rating);
+        const auto last = remove_if(policy, matched_documents.begin(), matched_documents.end(), [&cursor](const Document& document) {
+            return !IsRankedBefore(cursor, document);
+            });
+        matched_documents.erase(last, matched_documents.end());
+    }
+
+    // Only documents up to the end of the page are ordered
+    const size_t page_begin = min(options.offset, matched_documents.size());
+    const size_t page_end = page_begin + min(options.limit, matched_documents.size() - page_begin);
+    partial_sort(policy, matched_documents.begin(), matched_documents.begin() + page_end, matched_documents.end(), IsRankedBefore);
+
+    SearchResult result;
+    if (page_end < matched_documents.size() && page_end > page_begin) {
+        result.next_cursor = SearchCursor(matched_documents[page_end - 1]);
+    }
+    matched_documents.resize(page_end);
+    matched_documents.erase(matched_documents.begin(), matched_documents.begin() + page_begin);
+    result.documents = move(matched_documents);
+    return result;
+}
+
+template <typename DocumentIdRange>
+MatchedDocuments SearchServer::MatchDocuments(string_view raw_query, const DocumentIdRange& document_ids) const {
+    return MatchDocuments(execution::seq, raw_query, document_ids);
 }
 
+template <typename ExecutionPolicy, typename DocumentIdRange>
+MatchedDocuments SearchServer::MatchDocuments(ExecutionPolicy&& policy, string_view raw_query, const DocumentIdRange& document_ids) const {
+    const ResolvedQuery query = ResolveQuery(ParseQuery(raw_query, false));
+
+    MatchedDocuments result;
+    result.document_ids.assign(std::begin(document_ids), std::end(document_ids));
+    result.statuses.resize(result.document_ids.size());
+    result.word_offsets.resize(result.document_ids.size() + 1);
+
+    if constexpr (is_same_v<decay_t<ExecutionPolicy>, execution::sequenced_policy>) {
+        for (size_t i = 0; i < result.document_ids.size(); ++i) {
+            result.statuses[i] = MatchResolvedQuery(query, result.document_ids[i], result.words);
+            result.word_offsets[i + 1] = result.words.size();
+        }
+    }
+    else {
+        vector<vector<string_view>> document_words(result.document_ids.size());
+        vector<size_t> indexes(result.document_ids.size());
+        iota(indexes.begin(), indexes.end(), 0);
+        for_each(policy, indexes.begin(), indexes.end(), [&](size_t i) {
+            result.statuses[i] = MatchResolvedQuery(query, result.document_ids[i], document_words[i]);
+            result.word_offsets[i + 1] = document_words[i].size();
+            });
+        inclusive_scan(result.word_offsets.begin(), result.word_offsets.end(), result.word_offsets.begin());
+        result.words.resize(result.word_offsets.back());
+        for_each(policy, indexes.begin(), indexes.end(), [&](size_t i) {
+            copy(document_words[i].begin(), document_words[i].end(), result.words.begin() + result.word_offsets[i]);
+            });
+    }
+    return result;
+}
 
 template<typename ExecutionPolicy>
 inline void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-    if (document_to_word_freqs_.count(document_id) == 0) {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
         return;
     }
-    vector<const std::string*> words_to_remove(document_to_word_freqs_.at(document_id).size());
-    
-    transform(
-        policy,
-        document_to_word_freqs_.at(document_id).begin(),
-        document_to_word_freqs_.at(document_id).end(),
-        words_to_remove.begin(),
-        [](auto &word_freqs) { return &word_freqs.first; });
-    
+    const auto first = forward_term_ids_.begin() + document->second.forward_offset;
     for_each(
         policy,
-        words_to_remove.begin(),
-        words_to_remove.end(),
-        [this, &document_id](const string* word) { word_to_document_freqs_.at(*word).erase(document_id); });
-    
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+        first,
+        first + document->second.forward_size,
+        [this, document_id](int term_id) { word_to_document_freqs_.at(term_id_to_word_[term_id]).erase(document_id); });
+    if (options_.partition_by_status) {
+        auto& partition = status_word_to_document_freqs_[static_cast<int>(document->second.status)];
+        for_each(
+            policy,
+            first,
+            first + document->second.forward_size,
+            [this, &partition, document_id](int term_id) { partition.at(term_id_to_word_[term_id]).erase(document_id); });
+    }
+
+    EraseDocumentData(document_id);
 }
 
 
-template <typename DocumentPredicate, class ExecutionPolicy>
-vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const {
+template <typename DocumentPredicate>
+optional<vector<Document>> SearchServer::FindTopDocumentsByTiers(const Query& query, const DocumentPredicate& document_predicate, size_t top_count) const {
+    if (query.plus_words.empty() || query.plus_words.size() > MAX_TIERED_QUERY_WORDS || !query.required_words.empty()
+        || !query.plus_prefixes.empty() || !query.minus_prefixes.empty() || !query.plus_fuzzy_words.empty()
+        || !query.minus_fuzzy_words.empty() || !query.phrases.empty() || top_count == 0) {
+        return nullopt;
+    }
+    SEARCH_STAGE(SearchStage::POSTING_SCAN);
+
+    // A document outside all tiers has at most the sum of the tail bounds
+    const TfIdfScorer scorer;
+    const CorpusStats corpus_stats = GetCorpusStats();
+    vector<pair<const Postings*, TfIdfScorer::WordScorer>> words;
+    vector<int> candidates;
+    double tail_bound = 0.0;
+    bool has_tail = false;
+    for (const auto word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end() || postings->second.empty()) {
+            continue;
+        }
+        const PostingTier& tier = word_to_tiers_.at(word);
+        const auto word_scorer = scorer.ForWord(corpus_stats, postings->second.size());
+        words.push_back({ &postings->second, word_scorer });
+        tail_bound += word_scorer(tier.tail_max_term_freq, 0);
+        has_tail = has_tail || tier.tail_max_term_freq > 0;
+        for (const auto& [term_freq, document_id] : tier.postings) {
+            candidates.push_back(document_id);
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+    SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, candidates.size() * words.size());
+
+    vector<const Postings*> minus_postings;
+    for (const auto word : query.minus_words) {
+        if (const auto postings = word_to_document_freqs_.find(word); postings != word_to_document_freqs_.end()) {
+            minus_postings.push_back(&postings->second);
+        }
+    }
+
+    vector<Document> matched_documents;
+    for (const int document_id : candidates) {
+        const auto& document_data = documents_.at(document_id);
+        const bool has_minus_word = any_of(minus_postings.begin(), minus_postings.end(), [document_id](const Postings* postings) {
+            return postings->count(document_id) > 0;
+            });
+        if (has_minus_word || !document_predicate(document_id, document_data.status, document_data.rating)) {
+            continue;
+        }
+        // With at most two words the sum does not depend on their order, so it equals the exhaustive one
+        double relevance = 0.0;
+        for (const auto& [postings, word_scorer] : words) {
+            if (const auto it = postings->find(document_id); it != postings->end()) {
+                relevance += word_scorer(it->second, document_data.word_count);
+            }
+        }
+        matched_documents.push_back({ document_id, relevance, document_data.rating });
+    }
+    if (!has_tail) {
+        CountTierQuery(true);
+        return matched_documents;
+    }
+
+    // Every one of the first top_count documents must outrank any document of the tails
+    // by relevance alone, and one more document keeps next_cursor as in the exhaustive search
+    if (matched_documents.size() > top_count) {
+        nth_element(matched_documents.begin(), matched_documents.begin() + (top_count - 1), matched_documents.end(), IsRankedBefore);
+        const double min_relevance = min_element(matched_documents.begin(), matched_documents.begin() + top_count,
+            [](const Document& lhs, const Document& rhs) { return lhs.relevance < rhs.relevance; })->relevance;
+        if (min_relevance - tail_bound >= ACCURACY) {
+            CountTierQuery(true);
+            return matched_documents;
+        }
+    }
+    CountTierQuery(false);
+    return nullopt;
+}
+
+template <typename Scorer, typename DocumentPredicate>
+vector<Document> SearchServer::FindConjunctiveDocuments(const Query& query, const DocumentPredicate& document_predicate,
+    const WordIndex& scanned_index) const {
+    SEARCH_STAGE(SearchStage::POSTING_SCAN);
+    const auto required = PlanPostings(query.required_words, scanned_index);
+    if (required.size() < query.required_words.size()) {
+        return {};
+    }
+
+    const Scorer scorer;
+    const CorpusStats corpus_stats = GetCorpusStats();
+    using WordScorer = decltype(scorer.ForWord(corpus_stats, 0));
+    vector<WordScorer> required_scorers;
+    for (const auto& [word, postings] : required) {
+        required_scorers.push_back(scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size()));
+    }
+
+    // Optional words are probed only for the documents of the intersection
+    struct OptionalWord {
+        const Postings* postings;
+        WordScorer word_scorer;
+        double weight;
+    };
+    vector<OptionalWord> optional_words;
+    vector<string_view> optional_plain_words;
+    set_difference(query.plus_words.begin(), query.plus_words.end(), query.required_words.begin(), query.required_words.end(),
+        back_inserter(optional_plain_words));
+    for (const auto& [word, postings] : PlanPostings(optional_plain_words, scanned_index)) {
+        optional_words.push_back({ postings, scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size()), 1.0 });
+    }
+    for (const auto& fuzzy_word : query.plus_fuzzy_words) {
+        for (const auto& [word, distance] : ExpandFuzzyWord(fuzzy_word)) {
+            if (const auto postings = scanned_index.find(word); postings != scanned_index.end()) {
+                optional_words.push_back({ &postings->second, scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size()), 1.0 / (1 + distance) });
+            }
+        }
+    }
+    vector<pair<vector<pair<int, double>>, WordScorer>> optional_prefixes;
+    for (const auto prefix : query.plus_prefixes) {
+        auto postings = MergePostings(ExpandPrefix(prefix));
+        if (!postings.empty()) {
+            const auto word_scorer = scorer.ForWord(corpus_stats, postings.size());
+            optional_prefixes.push_back({ move(postings), word_scorer });
+        }
+    }
+    vector<const Postings*> minus_postings;
+    auto add_minus_word = [&minus_postings, &scanned_index](string_view word) {
+        if (const auto postings = scanned_index.find(word); postings != scanned_index.end()) {
+            minus_postings.push_back(&postings->second);
+        }
+    };
+    for_each(query.minus_words.begin(), query.minus_words.end(), add_minus_word);
+    for (const auto prefix : query.minus_prefixes) {
+        for (const auto word : ExpandPrefix(prefix)) {
+            add_minus_word(word);
+        }
+    }
+    for (const auto& fuzzy_word : query.minus_fuzzy_words) {
+        for (const auto& [word, _] : ExpandFuzzyWord(fuzzy_word)) {
+            add_minus_word(word);
+        }
+    }
+
+    vector<Postings::const_iterator> cursors;
+    for (const auto& [word, postings] : required) {
+        cursors.push_back(postings->begin());
+    }
+    const Postings& rarest = *required[0].second;
+    size_t postings_touched = 0;
+    vector<Document> matched_documents;
+    while (cursors[0] != rarest.end()) {
+        // Every list is moved to the candidate, a list without it proposes the next candidate
+        int candidate = cursors[0]->first;
+        size_t aligned = 1;
+        for (; aligned < required.size(); ++aligned) {
+            auto& cursor = cursors[aligned];
+            cursor = SeekPosting(*required[aligned].second, cursor, candidate);
+            ++postings_touched;
+            if (cursor == required[aligned].second->end() || cursor->first != candidate) {
+                break;
+            }
+        }
+        if (aligned < required.size()) {
+            if (cursors[aligned] == required[aligned].second->end()) {
+                break;
+            }
+            cursors[0] = SeekPosting(rarest, cursors[0], cursors[aligned]->first);
+            ++postings_touched;
+            continue;
+        }
+
+        const auto& document_data = documents_.at(candidate);
+        const bool has_minus_word = any_of(minus_postings.begin(), minus_postings.end(), [candidate](const Postings* postings) {
+            return postings->count(candidate) > 0;
+            });
+        if (!has_minus_word && document_predicate(candidate, document_data.status, document_data.rating)) {
+            double relevance = 0.0;
+            for (size_t i = 0; i < required.size(); ++i) {
+                relevance += required_scorers[i](cursors[i]->second, document_data.word_count);
+            }
+            for (const auto& optional_word : optional_words) {
+                if (const auto it = optional_word.postings->find(candidate); it != optional_word.postings->end()) {
+                    relevance += optional_word.word_scorer(it->second, document_data.word_count) * optional_word.weight;
+                }
+            }
+            for (const auto& [postings, word_scorer] : optional_prefixes) {
+                if (const auto it = PostingLowerBound(postings, candidate); it != postings.end() && it->first == candidate) {
+                    relevance += word_scorer(it->second, document_data.word_count);
+                }
+            }
+            matched_documents.push_back({ candidate, relevance, document_data.rating });
+        }
+        ++cursors[0];
+        ++postings_touched;
+    }
+    SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings_touched);
+    return matched_documents;
+}
+
+template <typename Scorer, typename DocumentPredicate>
+vector<Document> SearchServer::FindAllDocumentsWithinBudget(const Query& query, const DocumentPredicate& document_predicate,
+    const WordIndex& scanned_index, QueryBudget& budget) const {
+    map<int, double> document_to_relevance;
+    {
+        SEARCH_STAGE(SearchStage::POSTING_SCAN);
+        const Scorer scorer;
+        const CorpusStats corpus_stats = GetCorpusStats();
+        size_t postings_touched = 0;
+        // Scores are kept per word and added up in the sorted order of the words afterwards,
+        // so a scan which was not cut short gives the relevance of FindAllDocuments to the last bit
+        const auto word_postings = FindPostings(query.plus_words, scanned_index);
+        vector<vector<pair<int, double>>> word_scores(word_postings.size());
+        vector<size_t> scan_order(word_postings.size());
+        iota(scan_order.begin(), scan_order.end(), 0);
+        sort(scan_order.begin(), scan_order.end(), [&word_postings](size_t lhs, size_t rhs) {
+            return word_postings[lhs].second->size() < word_postings[rhs].second->size();
+            });
+        for (const size_t word_index : scan_order) {
+            const auto& [word, postings] = word_postings[word_index];
+            const auto word_scorer = scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size());
+            auto visit = [&](int document_id, double term_freq) {
+                ++postings_touched;
+                const auto& document_data = documents_.at(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    word_scores[word_index].push_back({ document_id, word_scorer(term_freq, document_data.word_count) });
+                }
+            };
+
+            vector<int> tier_document_ids;
+            if (options_.tiered_postings) {
+                auto tier = word_to_tiers_.at(word).postings;
+                sort(tier.begin(), tier.end(), greater<>());
+                for (const auto& [term_freq, document_id] : tier) {
+                    if (!budget.Spend()) {
+                        break;
+                    }
+                    visit(document_id, term_freq);
+                    tier_document_ids.push_back(document_id);
+                }
+                sort(tier_document_ids.begin(), tier_document_ids.end());
+            }
+            for (const auto& [document_id, term_freq] : *postings) {
+                if (binary_search(tier_document_ids.begin(), tier_document_ids.end(), document_id)) {
+                    continue;
+                }
+                if (!budget.Spend()) {
+                    break;
+                }
+                visit(document_id, term_freq);
+            }
+            if (budget.is_exhausted) {
+                break;
+            }
+        }
+        for (const auto& scores : word_scores) {
+            for (const auto& [document_id, score] : scores) {
+                document_to_relevance[document_id] += score;
+            }
+        }
+        SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings_touched);
+    }
+
+    // Minus words are probed only for the found documents, so they cost no budget
+    vector<const Postings*> minus_postings;
+    for (const auto word : query.minus_words) {
+        if (const auto postings = scanned_index.find(word); postings != scanned_index.end()) {
+            minus_postings.push_back(&postings->second);
+        }
+    }
+    vector<Document> matched_documents;
+    {
+        SEARCH_STAGE(SearchStage::MINUS_FILTER);
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            const bool has_minus_word = any_of(minus_postings.begin(), minus_postings.end(), [document_id = document_id](const Postings* postings) {
+                return postings->count(document_id) > 0;
+                });
+            if (!has_minus_word) {
+                matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+            }
+        }
+    }
+
+    FilterPhrases(execution::seq, query, matched_documents);
+    SEARCH_COUNT(SearchCounter::CANDIDATES_SCORED, matched_documents.size());
+    return matched_documents;
+}
+
+template <typename Scorer, typename DocumentPredicate, typename ExecutionPolicy>
+vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+    const WordIndex& scanned_index, const SearchOptions& options) const {
     
+    if constexpr (is_same_v<Scorer, QuantizedTfIdfScorer>) {
+        if (!options_.quantize_impacts) {
+            throw logic_error("QuantizedTfIdfScorer requires the impact index"s);
+        }
+        if (query.plus_prefixes.empty() && query.minus_prefixes.empty() && query.plus_fuzzy_words.empty() && query.minus_fuzzy_words.empty()
+            && query.required_words.empty()) {
+            auto matched_documents = SelectPageCandidates(FindAllDocumentsByImpacts(query, document_predicate), options, query.phrases.empty());
+            FilterPhrases(policy, query, matched_documents);
+            SEARCH_COUNT(SearchCounter::CANDIDATES_SCORED, matched_documents.size());
+            return matched_documents;
+        }
+    }
+
+    if (!query.required_words.empty()) {
+        auto matched_documents = SelectPageCandidates(FindConjunctiveDocuments<Scorer>(query, document_predicate, scanned_index), options,
+            query.phrases.empty());
+        FilterPhrases(policy, query, matched_documents);
+        SEARCH_COUNT(SearchCounter::CANDIDATES_SCORED, matched_documents.size());
+        return matched_documents;
+    }
+
     ConcurrentMap<int, double> document_to_relevance(MAX_THREAD);
+    const Scorer scorer;
+    const CorpusStats corpus_stats = GetCorpusStats();
     
-    auto f_plus = [this, &document_predicate, &document_to_relevance](const string_view word) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    auto f_plus = [this, &document_predicate, &document_to_relevance, &scorer, &corpus_stats](const pair<string_view, const Postings*>& word_postings) {
+        const auto& [word, postings] = word_postings;
+        SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings->size());
+        const auto word_scorer = scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size());
+        ScanPostings(*postings, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+            document_to_relevance[document_id].ref_to_value += word_scorer(term_freq, document_data.word_count);
+            });
+    };
+    // All expansions of a prefix are scored as a single word, the document frequency of
+    // the merged word needs the union of the whole posting lists, so they are always scanned
+    auto f_plus_prefix = [this, &document_predicate, &document_to_relevance, &scorer, &corpus_stats](const string_view prefix) {
+        const auto postings = MergePostings(ExpandPrefix(prefix));
+        if (postings.empty()) {
             return;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+        const auto word_scorer = scorer.ForWord(corpus_stats, postings.size());
+        ScanPostings(postings, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+            document_to_relevance[document_id].ref_to_value += word_scorer(term_freq, document_data.word_count);
+            });
+    };
+    // Relevance of a similar word is discounted by its edit distance
+    auto f_plus_fuzzy = [this, &document_predicate, &document_to_relevance, &scorer, &corpus_stats, &scanned_index](const FuzzyWord& fuzzy_word) {
+        for (const auto& [word, distance] : ExpandFuzzyWord(fuzzy_word)) {
+            const auto postings = scanned_index.find(word);
+            if (postings == scanned_index.end()) {
+                continue;
             }
+            SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings->second.size());
+            const auto word_scorer = scorer.ForWord(corpus_stats, word_to_document_freqs_.at(word).size());
+            const double weight = 1.0 / (1 + distance);
+            ScanPostings(postings->second, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+                document_to_relevance[document_id].ref_to_value += word_scorer(term_freq, document_data.word_count) * weight;
+                });
         }
     };
-    for_each(policy, query.plus_words.begin(), query.plus_words.end(), f_plus);
+    {
+        SEARCH_STAGE(SearchStage::POSTING_SCAN);
+        // Words are added in their sorted order, the rarest-first plan is kept for conjunctive queries
+        const auto plus_postings = FindPostings(query.plus_words, scanned_index);
+        for_each(policy, plus_postings.begin(), plus_postings.end(), f_plus);
+        for_each(policy, query.plus_prefixes.begin(), query.plus_prefixes.end(), f_plus_prefix);
+        for_each(policy, query.plus_fuzzy_words.begin(), query.plus_fuzzy_words.end(), f_plus_fuzzy);
+    }
 
 
-    auto f_minus = [this, &document_predicate, &document_to_relevance](const string_view word) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    auto f_minus = [&document_to_relevance, &scanned_index](const string_view word) {
+        const auto postings = scanned_index.find(word);
+        if (postings == scanned_index.end()) {
             return;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
+        SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings->second.size());
+        for (const auto [document_id, _] : postings->second) {
             document_to_relevance.erase(document_id);
         }
     };
 
-    for_each(policy, query.minus_words.begin(), query.minus_words.end(), f_minus);
+    {
+        SEARCH_STAGE(SearchStage::MINUS_FILTER);
+        for_each(policy, query.minus_words.begin(), query.minus_words.end(), f_minus);
+        for_each(policy, query.minus_prefixes.begin(), query.minus_prefixes.end(), [this, &f_minus](const string_view prefix) {
+            for (const auto word : ExpandPrefix(prefix)) {
+                f_minus(word);
+            }
+            });
+        for_each(policy, query.minus_fuzzy_words.begin(), query.minus_fuzzy_words.end(), [this, &f_minus](const FuzzyWord& fuzzy_word) {
+            for (const auto& [word, _] : ExpandFuzzyWord(fuzzy_word)) {
+                f_minus(word);
+            }
+            });
+    }
 
-    vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    PageCandidates page(options, query.phrases.empty());
+    const auto document_relevances = document_to_relevance.BuildOrdinaryMap();
+    for (const auto [document_id, relevance] : document_relevances) {
+        page.Add({ document_id, relevance, documents_.at(document_id).rating });
     }
+    vector<Document> matched_documents = move(page.documents);
+
+    FilterPhrases(policy, query, matched_documents);
+    SEARCH_COUNT(SearchCounter::CANDIDATES_SCORED, document_relevances.size());
 
     return matched_documents;
+}
+
+// Scores are accumulated as integers in an array indexed by the dense document numbers,
+// the inner loop is a plain scatter add over two flat arrays
+template <typename DocumentPredicate>
+vector<Document> SearchServer::FindAllDocumentsByImpacts(const Query& query, DocumentPredicate document_predicate) const {
+    vector<uint32_t> scores(impact_document_ids_.size());
+    {
+        SEARCH_STAGE(SearchStage::POSTING_SCAN);
+        for (const auto word : query.plus_words) {
+            const auto postings = word_to_impacts_.find(word);
+            if (postings == word_to_impacts_.end()) {
+                continue;
+            }
+            const uint32_t* numbers = postings->second.document_numbers.data();
+            const uint16_t* impacts = postings->second.impacts.data();
+            const size_t size = postings->second.impacts.size();
+            SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, size);
+            for (size_t i = 0; i < size; ++i) {
+                scores[numbers[i]] += impacts[i];
+            }
+        }
+    }
+    {
+        SEARCH_STAGE(SearchStage::MINUS_FILTER);
+        for (const auto word : query.minus_words) {
+            if (const auto postings = word_to_impacts_.find(word); postings != word_to_impacts_.end()) {
+                SEARCH_COUNT(SearchCounter::POSTINGS_TOUCHED, postings->second.document_numbers.size());
+                for (const uint32_t number : postings->second.document_numbers) {
+                    scores[number] = 0;
+                }
+            }
+        }
+    }
+
+    // Every impact is at least 1, so a zero score means the document is not found
+    vector<Document> matched_documents;
+    for (size_t number = 0; number < scores.size(); ++number) {
+        if (scores[number] == 0 || impact_document_ids_[number] < 0) {
+            continue;
+        }
+        const int document_id = impact_document_ids_[number];
+        const auto& document_data = documents_.at(document_id);
+        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+            matched_documents.push_back({ document_id, scores[number] * impact_scale_, document_data.rating });
+        }
+    }
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::FilterPhrases(ExecutionPolicy&& policy, const Query& query, vector<Document>& matched_documents) const {
+    if (query.phrases.empty()) {
+        return;
+    }
+    vector<ResolvedPhrase> phrases;
+    if (!ResolvePhrases(query.phrases, phrases)) {
+        matched_documents.clear();
+        return;
+    }
+    // Positions are decoded only for documents which contain all phrase words
+    const auto last = remove_if(policy, matched_documents.begin(), matched_documents.end(), [this, &phrases](const Document& document) {
+        const auto& document_data = documents_.at(document.id);
+        return !all_of(phrases.begin(), phrases.end(), [this, &document_data](const ResolvedPhrase& phrase) {
+            return MatchesPhrase(document_data, phrase);
+            });
+        });
+    matched_documents.erase(last, matched_documents.end());
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+
+// Finds the first element not less than value. The step doubles from the
+// beginning of the range, so the cost is logarithmic in the distance to the
+// answer rather than in the size of the range.
+template <typename Iterator, typename T>
+Iterator GallopingLowerBound(Iterator first, Iterator last, const T& value) {
+    typename std::iterator_traits<Iterator>::difference_type step = 1;
+    Iterator low = first;
+    while (low != last && *low < value) {
+        first = std::next(low);
+        if (std::distance(first, last) <= step) {
+            low = last;
+            break;
+        }
+        low = std::next(first, step - 1);
+        step *= 2;
+    }
+    return std::lower_bound(first, low, value);
+}
+
+namespace detail {
+
+template <typename DriverIterator, typename GallopIterator, typename Callback>
+void IntersectByGalloping(DriverIterator driver_first, DriverIterator driver_last, GallopIterator gallop_first, GallopIterator gallop_last, Callback on_match) {
+    for (; driver_first != driver_last && gallop_first != gallop_last; ++driver_first) {
+        gallop_first = GallopingLowerBound(gallop_first, gallop_last, *driver_first);
+        if (gallop_first != gallop_last && !(*driver_first < *gallop_first)) {
+            on_match(driver_first, gallop_first);
+            ++gallop_first;
+        }
+    }
+}
+
+} // namespace detail
+
+// Calls on_match(lhs_it, rhs_it) for every common element of two sorted ranges
+// without duplicates. The shorter range drives and the longer one is galloped.
+template <typename LhsIterator, typename RhsIterator, typename Callback>
+void IntersectSorted(LhsIterator lhs_first, LhsIterator lhs_last, RhsIterator rhs_first, RhsIterator rhs_last, Callback on_match) {
+    if (std::distance(lhs_first, lhs_last) <= std::distance(rhs_first, rhs_last)) {
+        detail::IntersectByGalloping(lhs_first, lhs_last, rhs_first, rhs_last, on_match);
+    }
+    else {
+        detail::IntersectByGalloping(rhs_first, rhs_last, lhs_first, lhs_last, [&on_match](RhsIterator rhs_it, LhsIterator lhs_it) {
+            on_match(lhs_it, rhs_it);
+            });
+    }
+}
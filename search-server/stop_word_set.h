@@ -0,0 +1,222 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+const uint32_t MAX_STOP_WORD_SEED = 1 << 16; // seeds tried for one bucket before the table is given up
+const size_t STOP_WORD_BUCKET_SIZE = 4; // average words per bucket of the perfect hash
+
+// FNV-1a, every word is hashed once per lookup
+constexpr uint64_t HashStopWord(string_view word) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : word) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+constexpr size_t GetStopWordBucket(uint64_t hash, size_t bucket_count) {
+    return static_cast<size_t>(hash >> 32) % bucket_count;
+}
+
+// The seed of the bucket selects one function of the family, so words of a bucket can be moved
+// to free slots without touching other buckets
+constexpr size_t GetStopWordSlot(uint64_t hash, uint32_t seed, size_t slot_mask) {
+    hash ^= seed * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(hash ^ (hash >> 31)) & slot_mask;
+}
+
+// A power of two at least twice the number of words, so a seed for a bucket is found in a few tries
+constexpr size_t GetStopWordSlotCount(size_t word_count) {
+    size_t slot_count = 1;
+    while (slot_count < 2 * word_count) {
+        slot_count *= 2;
+    }
+    return slot_count;
+}
+
+constexpr size_t GetStopWordBucketCount(size_t word_count) {
+    return max<size_t>(1, (word_count + STOP_WORD_BUCKET_SIZE - 1) / STOP_WORD_BUCKET_SIZE);
+}
+
+// Bit min(length, 63) is set for every word length, most tokens are rejected without hashing
+constexpr uint64_t GetStopWordLengthBit(size_t length) {
+    return uint64_t{1} << min<size_t>(length, 63);
+}
+
+// Hash and displace: the words of every bucket get the first seed that moves all of them to free
+// slots. Empty and repeated words are skipped. Returns the length mask of the placed words.
+// Containers are indexed only, so the same code fills vectors at run time and arrays at compile time
+template <typename Words, typename Hashes, typename Slots, typename Seeds>
+constexpr uint64_t BuildStopWordTable(const Words& words, Hashes& hashes, Slots& slots, Seeds& seeds) {
+    const size_t slot_mask = slots.size() - 1;
+    uint64_t length_mask = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        hashes[i] = HashStopWord(words[i]);
+    }
+    for (size_t bucket = 0; bucket < seeds.size(); ++bucket) {
+        uint32_t seed = 0;
+        for (;; ++seed) {
+            if (seed == MAX_STOP_WORD_SEED) {
+                throw logic_error("Stop words cannot be placed into the table");
+            }
+            size_t placed = 0;
+            bool is_placed = true;
+            for (; placed < words.size(); ++placed) {
+                if (words[placed].empty() || GetStopWordBucket(hashes[placed], seeds.size()) != bucket) {
+                    continue;
+                }
+                const size_t slot = GetStopWordSlot(hashes[placed], seed, slot_mask);
+                if (slots[slot] == words[placed]) {
+                    continue;  // Repeated word, it lands on the same slot with the same seed
+                }
+                if (!slots[slot].empty()) {
+                    is_placed = false;
+                    break;
+                }
+                slots[slot] = words[placed];
+            }
+            if (is_placed) {
+                break;
+            }
+            // Frees the slots taken with this seed before the collision
+            for (size_t i = 0; i < placed; ++i) {
+                if (!words[i].empty() && GetStopWordBucket(hashes[i], seeds.size()) == bucket) {
+                    slots[GetStopWordSlot(hashes[i], seed, slot_mask)] = string_view{};
+                }
+            }
+        }
+        seeds[bucket] = seed;
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (!words[i].empty()) {
+            length_mask |= GetStopWordLengthBit(words[i].size());
+        }
+    }
+    return length_mask;
+}
+
+// One length check, one hash of the word, one comparison; nothing is allocated
+template <typename Slots, typename Seeds>
+constexpr bool FindInStopWordTable(const Slots& slots, const Seeds& seeds, uint64_t length_mask, string_view word) {
+    if ((length_mask & GetStopWordLengthBit(word.size())) == 0) {
+        return false;
+    }
+    const uint64_t hash = HashStopWord(word);
+    const uint32_t seed = seeds[GetStopWordBucket(hash, seeds.size())];
+    return slots[GetStopWordSlot(hash, seed, slots.size() - 1)] == word;
+}
+
+// Perfect hash of stop words known at compile time:
+//     constexpr StaticStopWordSet stop_words(array{"and"sv, "in"sv, "on"sv});
+// The set views the words, string literals outlive every user of it
+template <size_t WordCount>
+class StaticStopWordSet {
+public:
+    static constexpr size_t SLOT_COUNT = GetStopWordSlotCount(WordCount);
+    static constexpr size_t BUCKET_COUNT = GetStopWordBucketCount(WordCount);
+
+    constexpr explicit StaticStopWordSet(const array<string_view, WordCount>& words) {
+        for (string_view& slot : slots_) {
+            slot = string_view{};  // Every element is written, GCC rejects reads of elements left to the initializer
+        }
+        for (const string_view word : words) {
+            for (const char c : word) {
+                if (c >= '\0' && c < ' ') {
+                    throw invalid_argument("Some of stop words are invalid");
+                }
+            }
+        }
+        array<uint64_t, WordCount> hashes{};
+        length_mask_ = BuildStopWordTable(words, hashes, slots_, seeds_);
+    }
+
+    constexpr bool Contains(string_view word) const {
+        return FindInStopWordTable(slots_, seeds_, length_mask_, word);
+    }
+
+    // Free slots hold empty views
+    constexpr const array<string_view, SLOT_COUNT>& GetSlots() const {
+        return slots_;
+    }
+
+    constexpr const array<uint32_t, BUCKET_COUNT>& GetSeeds() const {
+        return seeds_;
+    }
+
+    constexpr uint64_t GetLengthMask() const {
+        return length_mask_;
+    }
+
+private:
+    array<string_view, SLOT_COUNT> slots_{};
+    array<uint32_t, BUCKET_COUNT> seeds_{};
+    uint64_t length_mask_ = 0;
+};
+
+// Perfect hash of stop words given at run time, built once and never changed.
+// The set keeps its own copy of the words, shared between copies of the set, so the slots
+// stay valid when the set or the container it was built from is copied, moved or destroyed
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    template <typename StringContainer>
+    explicit StopWordSet(const StringContainer& words);
+
+    // Copies the tables built at compile time, the slots view the words of the static set
+    template <size_t WordCount>
+    explicit StopWordSet(const StaticStopWordSet<WordCount>& words)
+        : slots_(words.GetSlots().begin(), words.GetSlots().end())
+        , seeds_(words.GetSeeds().begin(), words.GetSeeds().end())
+        , length_mask_(words.GetLengthMask())
+    {
+    }
+
+    bool Contains(string_view word) const {
+        return FindInStopWordTable(slots_, seeds_, length_mask_, word);
+    }
+
+    size_t GetTableBytes() const {
+        return (words_ ? words_->capacity() : 0) + slots_.capacity() * sizeof(string_view) + seeds_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    // Never changed after construction, the slots view it
+    shared_ptr<const string> words_;
+    vector<string_view> slots_ = vector<string_view>(1);
+    vector<uint32_t> seeds_ = vector<uint32_t>(1);
+    uint64_t length_mask_ = 0;
+};
+
+template <typename StringContainer>
+StopWordSet::StopWordSet(const StringContainer& words) {
+    string text;
+    vector<size_t> sizes;
+    for (const auto& word : words) {
+        const string_view view = word;
+        text += view;
+        sizes.push_back(view.size());
+    }
+    words_ = make_shared<const string>(move(text));
+    vector<string_view> views;
+    views.reserve(sizes.size());
+    size_t offset = 0;
+    for (const size_t size : sizes) {
+        views.push_back(string_view(*words_).substr(offset, size));
+        offset += size;
+    }
+    vector<uint64_t> hashes(views.size());
+    slots_.assign(GetStopWordSlotCount(views.size()), string_view{});
+    seeds_.assign(GetStopWordBucketCount(views.size()), 0);
+    length_mask_ = BuildStopWordTable(views, hashes, slots_, seeds_);
+}
@@ -25,9 +25,10 @@ void FindTopDocuments(const SearchServer& search_server, const string& raw_query
 void MatchDocuments(const SearchServer& search_server, const string& query) {
     try {
         cout << "Матчинг документов по запросу: "s << query << endl;
-        for (auto document_id = search_server.begin(); document_id != search_server.end(); document_id++) {
-            const auto [words, status] = search_server.MatchDocument(query, *document_id);
-            PrintMatchDocumentResult(*document_id, words, status);
+        const auto matched = search_server.MatchDocuments(query, search_server);
+        for (size_t i = 0; i < matched.size(); ++i) {
+            const auto words = matched.GetWords(i);
+            PrintMatchDocumentResult(matched.document_ids[i], { words.begin(), words.end() }, matched.statuses[i]);
         }
     }
     catch (const invalid_argument& e) {
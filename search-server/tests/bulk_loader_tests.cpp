@@ -0,0 +1,114 @@
+#include "tests.h"
+
+#include <filesystem>
+#include <fstream>
+#include "../bulk_loader.h"
+
+using namespace std;
+
+namespace {
+
+// Lines of LoadDocuments for the documents of AddTestDocuments, statuses alternate between names and numbers
+string MakeBulkInput(const vector<string>& texts) {
+    static const string status_names[] = { "ACTUAL"s, "IRRELEVANT"s, "BANNED"s, "REMOVED"s };
+    string input;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const int status = static_cast<int>(i % DOCUMENT_STATUS_COUNT);
+        const int rating = static_cast<int>(i % 7) - 3;
+        input += to_string(i * 2 + 1) + '\t' + (i % 2 == 0 ? status_names[status] : to_string(status)) + '\t'
+            + to_string(rating) + ' ' + to_string(rating) + '\t' + texts[i] + (i % 3 == 0 ? "\r\n"s : "\n"s);
+    }
+    return input;
+}
+
+void AssertSameIndexes(const SearchServer& loaded_server, const SearchServer& expected_server, const vector<string>& queries) {
+    ASSERT_EQUAL(loaded_server.GetDocumentCount(), expected_server.GetDocumentCount());
+    SearchOptions options;
+    options.limit = 50;
+    for (const string& query : queries) {
+        for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            AssertSameDocuments(loaded_server.FindTopDocuments(query, static_cast<DocumentStatus>(status), options).documents,
+                expected_server.FindTopDocuments(query, static_cast<DocumentStatus>(status), options).documents, query);
+        }
+    }
+}
+
+// Small chunks keep several of them parsed ahead of the indexing
+void TestBulkLoadEqualsAddDocument() {
+    SearchServerOptions server_options;
+    server_options.store_positions = true;
+    const auto texts = GenerateTestTexts(30, 1500, 10, 150);
+    SearchServer expected_server("w7"s, server_options);
+    AddTestDocuments(expected_server, texts);
+
+    SearchServer loaded_server("w7"s, server_options);
+    BulkLoadOptions options;
+    options.chunk_size = 512;
+    options.max_chunks_in_flight = 3;
+    size_t progress_calls = 0;
+    options.on_progress = [&progress_calls](const BulkLoadProgress&) { ++progress_calls; };
+    const string input = MakeBulkInput(texts);
+    const BulkLoadProgress progress = LoadDocuments(loaded_server, input, options);
+    ASSERT_EQUAL(progress.documents, texts.size());
+    ASSERT_EQUAL(progress.bytes, input.size());
+    ASSERT(progress_calls > 1);
+
+    auto queries = GenerateTestQueries(31, 30, 3, 150);
+    queries.push_back("\"w1 w2\""s);
+    AssertSameIndexes(loaded_server, expected_server, queries);
+    for (const int id : { 1, 3, 2001 }) {
+        const auto [loaded_words, loaded_status] = loaded_server.MatchDocument("w1 w2 w3 w4"s, id);
+        const auto [expected_words, expected_status] = expected_server.MatchDocument("w1 w2 w3 w4"s, id);
+        ASSERT_EQUAL(loaded_words, expected_words);
+        ASSERT(loaded_status == expected_status);
+    }
+}
+
+void TestBulkLoadFromFile() {
+    const auto texts = GenerateTestTexts(32, 300, 8, 100);
+    const string path = (filesystem::temp_directory_path() / "search_server_bulk_loader_test.tsv").string();
+    {
+        ofstream file(path, ios::binary);
+        file << MakeBulkInput(texts);
+    }
+    SearchServer loaded_server(""s);
+    LoadDocumentsFromFile(loaded_server, path);
+    filesystem::remove(path);
+    SearchServer expected_server(""s);
+    AddTestDocuments(expected_server, texts);
+    AssertSameIndexes(loaded_server, expected_server, GenerateTestQueries(33, 20, 3, 100));
+    ASSERT_THROWS(LoadDocumentsFromFile(loaded_server, path), runtime_error);
+}
+
+void TestBulkLoadRejectsMalformedLines() {
+    SearchServer search_server(""s);
+    for (const string& input : { "1\tACTUAL\t1\tcat\n2\tUNKNOWN\t1\tdog\n"s, "1\tACTUAL\t1\tcat\nx\t0\t1\tdog\n"s,
+        "1\tACTUAL\tcat\n"s, "1\tACTUAL\t1 y\tcat\n"s }) {
+        ASSERT_THROWS(LoadDocuments(search_server, input), invalid_argument);
+    }
+
+    // Errors of AddDocument name the line too, also when it is parsed in a later chunk
+    auto get_error = [](const string& input) {
+        SearchServer search_server(""s);
+        BulkLoadOptions options;
+        options.chunk_size = 1;
+        try {
+            LoadDocuments(search_server, input, options);
+        }
+        catch (const invalid_argument& e) {
+            return string(e.what());
+        }
+        return string();
+    };
+    ASSERT_EQUAL(get_error("1\tACTUAL\t1\tcat\n2\tACTUAL\t1\tdog\n1\tBANNED\t2\tcat\n"s), "Line 3: Invalid document_id"s);
+    ASSERT_EQUAL(get_error("1\tACTUAL\t1\tcat\n\n-5\tACTUAL\t1\tdog\n"s), "Line 3: Invalid document_id"s);
+    ASSERT_EQUAL(get_error("1\tACTUAL\t1\tcat\n2\tUNKNOWN\t1\tdog\n"s), "Line 2: Invalid status UNKNOWN"s);
+}
+
+} // namespace
+
+void RunBulkLoaderTests(TestRunner& tr) {
+    RUN_TEST(tr, TestBulkLoadEqualsAddDocument);
+    RUN_TEST(tr, TestBulkLoadFromFile);
+    RUN_TEST(tr, TestBulkLoadRejectsMalformedLines);
+}
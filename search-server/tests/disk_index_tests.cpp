@@ -0,0 +1,104 @@
+#include "tests.h"
+
+#include <filesystem>
+#include <fstream>
+#include "../disk_index.h"
+
+using namespace std;
+
+namespace {
+
+string MakeTestIndexPath(const string& name) {
+    return (filesystem::temp_directory_path() / ("search_server_"s + name + ".index"s)).string();
+}
+
+// Builds the index of the AddTestDocuments documents and returns its build stats
+DiskIndexBuildStats BuildTestIndex(const string& path, const string& stop_words, const vector<string>& texts, size_t memory_limit) {
+    DiskIndexBuildOptions options;
+    options.memory_limit = memory_limit;
+    DiskIndexBuilder builder(path, stop_words, options);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const int rating = static_cast<int>(i % 7) - 3;
+        builder.AddDocument(static_cast<int>(i) * 2 + 1, texts[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), { rating, rating });
+    }
+    return builder.Finish();
+}
+
+// The postings do not fit into the memory limit many times over, so the builder spills more
+// runs than it merges at once and needs a merge pass before the final merge
+void TestDiskIndexEqualsSearchServer() {
+    const string path = MakeTestIndexPath("disk_index_test"s);
+    const auto texts = GenerateTestTexts(40, 3000, 10, 200);
+    const size_t memory_limit = 4 << 10;
+    const DiskIndexBuildStats stats = BuildTestIndex(path, "w5 w9"s, texts, memory_limit);
+    ASSERT_EQUAL(stats.documents, texts.size());
+    ASSERT(stats.runs > 64);
+    ASSERT(stats.merge_passes > 0);
+    ASSERT(stats.peak_run_bytes < 2 * memory_limit);
+    for (size_t i = 0; i <= stats.runs; ++i) {
+        ASSERT(!filesystem::exists(path + ".run"s + to_string(i)));
+    }
+
+    SearchServer search_server("w5 w9"s);
+    AddTestDocuments(search_server, texts);
+    const DiskIndex disk_index(path);
+    ASSERT_EQUAL(disk_index.GetDocumentCount(), search_server.GetDocumentCount());
+    ASSERT_EQUAL(disk_index.GetWordCount(), stats.words);
+    ASSERT(disk_index.GetPostings("w5"sv).empty());
+
+    auto queries = GenerateTestQueries(41, 40, 4, 200);
+    queries.push_back("w1 -w0"s);
+    queries.push_back("unknown"s);
+    for (const string& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto expected = search_server.FindTopDocuments(query, status);
+            const auto actual = disk_index.FindTopDocuments(query, status);
+            AssertSameDocuments(actual, expected, query);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                AssertEqual(actual[i].relevance, expected[i].relevance, query + ": exact relevance"s);
+            }
+        }
+    }
+    filesystem::remove(path);
+}
+
+void TestDamagedDiskIndexIsRejected() {
+    const string path = MakeTestIndexPath("disk_index_damaged_test"s);
+    BuildTestIndex(path, "w5"s, GenerateTestTexts(42, 200, 8, 50), 64 << 20);
+    string contents;
+    {
+        ifstream file(path, ios::binary);
+        contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+    auto write_index = [&path](const string& data) {
+        ofstream file(path, ios::binary | ios::trunc);
+        file << data;
+    };
+
+    // Cut inside the posting list of the last word
+    write_index(contents.substr(0, contents.size() - 5));
+    ASSERT_THROWS(DiskIndex{ path }, runtime_error);
+    // Cut inside the document records
+    write_index(contents.substr(0, 40));
+    ASSERT_THROWS(DiskIndex{ path }, runtime_error);
+    // Size of the stop word grown far beyond the file
+    string damaged = contents;
+    damaged[3 * sizeof(uint32_t) + 3] = '\x7f';
+    write_index(damaged);
+    ASSERT_THROWS(DiskIndex{ path }, runtime_error);
+    // Not an index at all
+    damaged = contents;
+    damaged[0] = 'X';
+    write_index(damaged);
+    ASSERT_THROWS(DiskIndex{ path }, runtime_error);
+
+    filesystem::remove(path);
+    ASSERT_THROWS(DiskIndex{ path }, runtime_error);
+}
+
+} // namespace
+
+void RunDiskIndexTests(TestRunner& tr) {
+    RUN_TEST(tr, TestDiskIndexEqualsSearchServer);
+    RUN_TEST(tr, TestDamagedDiskIndexIsRejected);
+}
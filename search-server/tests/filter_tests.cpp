@@ -0,0 +1,94 @@
+#include "tests.h"
+
+#include <functional>
+#include <limits>
+#include "../search_server.h"
+
+using namespace std;
+
+namespace {
+
+SearchOptions MakeAllResultsOptions() {
+    SearchOptions options;
+    options.limit = numeric_limits<size_t>::max();
+    return options;
+}
+
+// Status partitions must give what the whole index filtered by status gives,
+// also after statuses change and documents are removed
+void TestStatusPartitionsEqualFullIndex() {
+    SearchServerOptions options;
+    options.partition_by_status = true;
+    SearchServer partitioned_server("w2"s, options);
+    SearchServer search_server("w2"s);
+    const auto texts = GenerateTestTexts(12, 400, 10, 100);
+    AddTestDocuments(partitioned_server, texts);
+    AddTestDocuments(search_server, texts);
+    const auto queries = GenerateTestQueries(13, 30, 3, 100);
+
+    auto assert_same = [&](const string& hint) {
+        for (const string& query : queries) {
+            for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                const auto document_status = static_cast<DocumentStatus>(status);
+                const auto expected = search_server.FindTopDocuments(query, [document_status](int, DocumentStatus status, int) {
+                    return status == document_status;
+                    }, MakeAllResultsOptions()).documents;
+                AssertSameDocuments(partitioned_server.FindTopDocuments(query, document_status, MakeAllResultsOptions()).documents, expected,
+                    hint + ": "s + query);
+                AssertSameDocuments(search_server.FindTopDocuments(query, document_status, MakeAllResultsOptions()).documents, expected,
+                    hint + ": "s + query);
+            }
+        }
+    };
+    assert_same("added"s);
+    for (int id = 1; id < 400; id += 6) {
+        partitioned_server.SetDocumentStatus(id, DocumentStatus::BANNED);
+        search_server.SetDocumentStatus(id, DocumentStatus::BANNED);
+    }
+    for (int id = 3; id < 400; id += 10) {
+        partitioned_server.RemoveDocument(id);
+        search_server.RemoveDocument(id);
+    }
+    assert_same("changed"s);
+    ASSERT_THROWS(search_server.SetDocumentStatus(3, DocumentStatus::ACTUAL), out_of_range);
+}
+
+// Every index-backed filter path gives the documents the same conditions give as an opaque predicate
+void TestDocumentFilterEqualsPredicate() {
+    SearchServerOptions options;
+    options.partition_by_status = true;
+    SearchServer partitioned_server(""s, options);
+    SearchServer search_server(""s);
+    const auto texts = GenerateTestTexts(14, 500, 10, 100);
+    AddTestDocuments(partitioned_server, texts);
+    AddTestDocuments(search_server, texts);
+
+    struct Case {
+        DocumentFilter filter;
+        function<bool(int, DocumentStatus, int)> predicate;
+    };
+    const vector<Case> cases = {
+        { DocumentFilter().SetRatingRange(2, 3),
+            [](int, DocumentStatus, int rating) { return rating >= 2 && rating <= 3; } },
+        { DocumentFilter().SetIdRange(100, 300).SetStatuses({ DocumentStatus::ACTUAL, DocumentStatus::BANNED }),
+            [](int id, DocumentStatus status, int) { return id >= 100 && id <= 300 && (status == DocumentStatus::ACTUAL || status == DocumentStatus::BANNED); } },
+        { DocumentFilter().SetStatuses({ DocumentStatus::IRRELEVANT }).SetRatingRange(-3, 0).SetPredicate([](int id, DocumentStatus, int) { return id % 3 == 0; }),
+            [](int id, DocumentStatus status, int rating) { return status == DocumentStatus::IRRELEVANT && rating <= 0 && id % 3 == 0; } },
+        { DocumentFilter().SetRatingRange(5, 9),
+            [](int, DocumentStatus, int) { return false; } },
+    };
+    for (const string& query : GenerateTestQueries(15, 30, 3, 100)) {
+        for (const Case& test_case : cases) {
+            const auto expected = search_server.FindTopDocuments(query, test_case.predicate, MakeAllResultsOptions()).documents;
+            AssertSameDocuments(search_server.FindTopDocuments(query, test_case.filter, MakeAllResultsOptions()).documents, expected, query);
+            AssertSameDocuments(partitioned_server.FindTopDocuments(query, test_case.filter, MakeAllResultsOptions()).documents, expected, query);
+        }
+    }
+}
+
+} // namespace
+
+void RunFilterTests(TestRunner& tr) {
+    RUN_TEST(tr, TestStatusPartitionsEqualFullIndex);
+    RUN_TEST(tr, TestDocumentFilterEqualsPredicate);
+}
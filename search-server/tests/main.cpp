@@ -0,0 +1,135 @@
+#include "tests.h"
+
+#include <cmath>
+#include <random>
+#include "../search_server.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+void AssertSameDocuments(const vector<Document>& actual, const vector<Document>& expected, const string& hint) {
+    AssertEqual(actual.size(), expected.size(), hint + ": document count"s);
+    for (size_t i = 0; i < actual.size(); ++i) {
+        const string position = hint + ": position "s + to_string(i);
+        AssertEqual(actual[i].id, expected[i].id, position);
+        AssertEqual(actual[i].rating, expected[i].rating, position);
+        Assert(abs(actual[i].relevance - expected[i].relevance) < ACCURACY, position + ": relevance"s);
+    }
+}
+
+void AssertIdenticalDocuments(const vector<Document>& actual, const vector<Document>& expected, const string& hint) {
+    AssertEqual(actual.size(), expected.size(), hint + ": document count"s);
+    for (size_t i = 0; i < actual.size(); ++i) {
+        const string position = hint + ": position "s + to_string(i);
+        AssertEqual(actual[i].id, expected[i].id, position);
+        AssertEqual(actual[i].rating, expected[i].rating, position);
+        AssertEqual(actual[i].relevance, expected[i].relevance, position);
+    }
+}
+
+namespace {
+
+string GenerateTestText(mt19937_64& generator, size_t word_count, size_t dictionary_size, double minus_probability) {
+    // The minimum of two uniform numbers, so the first words of the dictionary are more frequent
+    uniform_int_distribution<size_t> word_number(0, dictionary_size - 1);
+    bernoulli_distribution is_minus(minus_probability);
+    string text;
+    for (size_t i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        if (is_minus(generator)) {
+            text.push_back('-');
+        }
+        text += "w"s + to_string(min(word_number(generator), word_number(generator)));
+    }
+    return text;
+}
+
+} // namespace
+
+vector<string> GenerateTestTexts(uint64_t seed, size_t count, size_t word_count, size_t dictionary_size) {
+    mt19937_64 generator(seed);
+    vector<string> texts;
+    for (size_t i = 0; i < count; ++i) {
+        texts.push_back(GenerateTestText(generator, word_count, dictionary_size, 0.0));
+    }
+    return texts;
+}
+
+vector<string> GenerateTestQueries(uint64_t seed, size_t count, size_t word_count, size_t dictionary_size) {
+    mt19937_64 generator(seed);
+    vector<string> queries;
+    for (size_t i = 0; i < count; ++i) {
+        queries.push_back(GenerateTestText(generator, word_count, dictionary_size, 0.2));
+    }
+    return queries;
+}
+
+void AddTestDocuments(SearchServer& search_server, const vector<string>& texts, bool all_actual) {
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const DocumentStatus status = all_actual ? DocumentStatus::ACTUAL : static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT);
+        const int rating = static_cast<int>(i % 7) - 3;
+        search_server.AddDocument(static_cast<int>(i) * 2 + 1, texts[i], status, { rating, rating });
+    }
+}
+
+vector<Document> RankTestTexts(const vector<string>& texts, bool all_actual, const map<string, double>& word_weights,
+    const set<string>& minus_words) {
+    map<string, int> document_freqs;
+    for (const string& text : texts) {
+        const auto words = SplitIntoWords(text);
+        for (const string_view word : set<string_view>(words.begin(), words.end())) {
+            ++document_freqs[string(word)];
+        }
+    }
+    vector<Document> documents;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (!all_actual && i % DOCUMENT_STATUS_COUNT != 0) {
+            continue;
+        }
+        const auto words = SplitIntoWords(texts[i]);
+        map<string, int> counts;
+        bool has_minus_word = false;
+        for (const string_view word : words) {
+            ++counts[string(word)];
+            has_minus_word = has_minus_word || minus_words.count(string(word)) > 0;
+        }
+        double relevance = 0.0;
+        bool has_plus_word = false;
+        for (const auto& [word, weight] : word_weights) {
+            if (const auto count = counts.find(word); count != counts.end()) {
+                has_plus_word = true;
+                relevance += weight * count->second / words.size() * log(texts.size() * 1.0 / document_freqs.at(word));
+            }
+        }
+        if (has_plus_word && !has_minus_word) {
+            documents.push_back({ static_cast<int>(i) * 2 + 1, relevance, static_cast<int>(i % 7) - 3 });
+        }
+    }
+    sort(documents.begin(), documents.end(), [](const Document& lhs, const Document& rhs) {
+        if (abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+            return lhs.relevance > rhs.relevance;
+        }
+        return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+        });
+    return documents;
+}
+
+int main() {
+    TestRunner tr;
+    RunNearDuplicateTests(tr);
+    RunMatchDocumentsTests(tr);
+    RunPaginationTests(tr);
+    RunQuerySyntaxTests(tr);
+    RunRankingTests(tr);
+    RunFilterTests(tr);
+    RunSearchPathTests(tr);
+    RunBulkLoaderTests(tr);
+    RunDiskIndexTests(tr);
+    RunRequestQueueTests(tr);
+    RunSearchMetricsTests(tr);
+    RunMemoryTests(tr);
+    RunStopWordTests(tr);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <random>
+#include "../search_server.h"
+#include "../sorted_intersection.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+namespace {
+
+void TestMatchDocumentsWords() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::BANNED, { 1 });
+    search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 1 });
+
+    const MatchedDocuments matched = search_server.MatchDocuments("fluffy groomed cat -collar"s, vector<int>{ 1, 2, 3 });
+    ASSERT_EQUAL(matched.size(), 3u);
+    ASSERT_EQUAL(matched.document_ids, (vector<int>{ 1, 2, 3 }));
+    ASSERT(matched.statuses[1] == DocumentStatus::BANNED);
+    ASSERT(matched.GetWords(0).begin() == matched.GetWords(0).end());
+    ASSERT_EQUAL(vector<string_view>(matched.GetWords(1).begin(), matched.GetWords(1).end()), (vector<string_view>{ "cat"sv, "fluffy"sv }));
+    ASSERT_EQUAL(vector<string_view>(matched.GetWords(2).begin(), matched.GetWords(2).end()), (vector<string_view>{ "groomed"sv }));
+
+    ASSERT_THROWS(search_server.MatchDocuments("cat"s, vector<int>{ 1, 4 }), out_of_range);
+}
+
+// Every document of the batch gets the same words and status as from MatchDocument
+void TestMatchDocumentsEqualsMatchDocument() {
+    const auto texts = GenerateTestTexts(1, 300, 12, 200);
+    SearchServer search_server("w3 w7"s);
+    vector<int> ids;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const int id = static_cast<int>(i) * 3;
+        search_server.AddDocument(id, texts[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), { 1 });
+        ids.push_back(id);
+    }
+    for (const string& query : GenerateTestQueries(2, 50, 4, 200)) {
+        const MatchedDocuments sequential = search_server.MatchDocuments(query, ids);
+        const MatchedDocuments parallel = search_server.MatchDocuments(execution::par, query, ids);
+        ASSERT_EQUAL(sequential.word_offsets, parallel.word_offsets);
+        ASSERT_EQUAL(sequential.words, parallel.words);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            const auto [words, status] = search_server.MatchDocument(query, ids[i]);
+            ASSERT_EQUAL(vector<string_view>(sequential.GetWords(i).begin(), sequential.GetWords(i).end()), words);
+            ASSERT(sequential.statuses[i] == status);
+        }
+    }
+}
+
+// Galloping intersection finds the same elements as std::set_intersection whichever range is longer
+void TestIntersectSortedEqualsSetIntersection() {
+    mt19937 generator(5);
+    for (int i = 0; i < 200; ++i) {
+        vector<int> lhs(generator() % 40);
+        vector<int> rhs(generator() % 400);
+        const int max_value = 1 + static_cast<int>(generator() % 1000);
+        for (int& value : lhs) {
+            value = static_cast<int>(generator() % max_value);
+        }
+        for (int& value : rhs) {
+            value = static_cast<int>(generator() % max_value);
+        }
+        for (vector<int>* values : { &lhs, &rhs }) {
+            sort(values->begin(), values->end());
+            values->erase(unique(values->begin(), values->end()), values->end());
+        }
+        vector<int> expected;
+        set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(expected));
+        for (const bool is_swapped : { false, true }) {
+            const vector<int>& first = is_swapped ? rhs : lhs;
+            const vector<int>& second = is_swapped ? lhs : rhs;
+            vector<int> actual;
+            IntersectSorted(first.begin(), first.end(), second.begin(), second.end(), [&actual](auto first_it, auto second_it) {
+                ASSERT_EQUAL(*first_it, *second_it);
+                actual.push_back(*first_it);
+                });
+            ASSERT_EQUAL(actual, expected);
+        }
+    }
+}
+
+// Plus words of the query found in the text, or none when the text has a minus word
+vector<string_view> MatchTestText(const string& query, const string& text) {
+    const vector<string_view> document_words = SplitIntoWords(text);
+    const auto has_word = [&document_words](string_view word) {
+        return find(document_words.begin(), document_words.end(), word) != document_words.end();
+    };
+    vector<string_view> matched_words;
+    for (string_view word : SplitIntoWords(query)) {
+        if (word[0] == '-') {
+            if (has_word(word.substr(1))) {
+                return {};
+            }
+        }
+        else if (has_word(word)) {
+            matched_words.push_back(word);
+        }
+    }
+    sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    return matched_words;
+}
+
+// Removing most documents compacts the term arrays, the surviving and the re-added documents
+// must still match every query word and keep their frequencies
+void TestMatchDocumentAfterCompaction() {
+    auto texts = GenerateTestTexts(6, 600, 12, 300);
+    SearchServer search_server(""s);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+    }
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (i % 4 != 0) {
+            search_server.RemoveDocument(static_cast<int>(i));
+        }
+    }
+    const auto new_texts = GenerateTestTexts(7, texts.size(), 8, 400);
+    for (size_t i = 1; i < texts.size(); i += 4) {
+        texts[i] = new_texts[i];
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+    }
+    ASSERT_EQUAL(static_cast<size_t>(search_server.GetDocumentCount()), texts.size() / 2);
+
+    const auto queries = GenerateTestQueries(8, 60, 5, 400);
+    for (const int document_id : search_server) {
+        const string& text = texts[document_id];
+        for (const string& query : queries) {
+            const auto [words, status] = search_server.MatchDocument(query, document_id);
+            AssertEqual(words, MatchTestText(query, text), query + " in "s + text);
+        }
+        const vector<string_view> document_words = SplitIntoWords(text);
+        size_t word_count = 0;
+        for (const auto [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            const auto count = std::count(document_words.begin(), document_words.end(), word);
+            Assert(abs(freq - static_cast<double>(count) / document_words.size()) < 1e-12, text);
+            ++word_count;
+        }
+        vector<string_view> unique_words = document_words;
+        sort(unique_words.begin(), unique_words.end());
+        ASSERT_EQUAL(word_count, static_cast<size_t>(unique(unique_words.begin(), unique_words.end()) - unique_words.begin()));
+    }
+}
+
+} // namespace
+
+void RunMatchDocumentsTests(TestRunner& tr) {
+    RUN_TEST(tr, TestMatchDocumentsWords);
+    RUN_TEST(tr, TestMatchDocumentsEqualsMatchDocument);
+    RUN_TEST(tr, TestIntersectSortedEqualsSetIntersection);
+    RUN_TEST(tr, TestMatchDocumentAfterCompaction);
+}
@@ -0,0 +1,190 @@
+#include "tests.h"
+
+#include <limits>
+#include <memory_resource>
+#include "../search_server.h"
+
+using namespace std;
+
+namespace {
+
+// Counts the allocations passed upstream and the bytes which are not released yet
+class CountingResource : public pmr::memory_resource {
+public:
+    explicit CountingResource(pmr::memory_resource* upstream)
+        : upstream_(upstream) {
+    }
+
+    size_t GetAllocationCount() const {
+        return allocation_count_;
+    }
+
+    size_t GetBytesInUse() const {
+        return bytes_in_use_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* const result = upstream_->allocate(bytes, alignment);
+        ++allocation_count_;
+        bytes_in_use_ += bytes;
+        return result;
+    }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+        bytes_in_use_ -= bytes;
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    pmr::memory_resource* const upstream_;
+    size_t allocation_count_ = 0;
+    size_t bytes_in_use_ = 0;
+};
+
+// Adds the same documents to every server, then removes every third one, adds it back with
+// another text and changes some statuses
+void FillAndChurn(const vector<SearchServer*>& servers) {
+    const auto texts = GenerateTestTexts(31, 900, 10, 250);
+    const auto new_texts = GenerateTestTexts(32, texts.size(), 12, 250);
+    for (SearchServer* search_server : servers) {
+        AddTestDocuments(*search_server, texts);
+        for (size_t i = 0; i < texts.size(); i += 3) {
+            const int id = static_cast<int>(i) * 2 + 1;
+            search_server->RemoveDocument(id);
+            search_server->AddDocument(id, new_texts[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), { static_cast<int>(i % 5) });
+        }
+        for (size_t i = 1; i < texts.size(); i += 7) {
+            search_server->SetDocumentStatus(static_cast<int>(i) * 2 + 1, DocumentStatus::BANNED);
+        }
+    }
+}
+
+// Nodes from a pool make no difference to the results, and the server returns them all
+void TestPoolServerEqualsDefaultServer() {
+    pmr::unsynchronized_pool_resource pool;
+    CountingResource counting(&pool);
+    {
+        SearchServerOptions options;
+        options.store_positions = true;
+        options.partition_by_status = true;
+        options.quantize_impacts = true;
+        options.tiered_postings = true;
+        SearchServer default_server("w7 w11"s, options);
+        options.memory_resource = &counting;
+        SearchServer pool_server("w7 w11"s, options);
+        FillAndChurn({ &default_server, &pool_server });
+        ASSERT(counting.GetAllocationCount() > 0);
+
+        ASSERT_EQUAL(vector<int>(pool_server.begin(), pool_server.end()), vector<int>(default_server.begin(), default_server.end()));
+        SearchOptions all_results;
+        all_results.limit = numeric_limits<size_t>::max();
+        auto queries = GenerateTestQueries(33, 40, 3, 250);
+        queries.push_back("\"w1 w2\" w3"s);
+        for (const string& query : queries) {
+            for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+                AssertIdenticalDocuments(pool_server.FindTopDocuments(query, status, all_results).documents,
+                    default_server.FindTopDocuments(query, status, all_results).documents, query);
+            }
+            AssertIdenticalDocuments(pool_server.FindTopDocuments<QuantizedTfIdfScorer>(query),
+                default_server.FindTopDocuments<QuantizedTfIdfScorer>(query), query);
+        }
+        for (const int document_id : default_server) {
+            const auto [expected_words, expected_status] = default_server.MatchDocument(queries.front(), document_id);
+            const auto [words, status] = pool_server.MatchDocument(queries.front(), document_id);
+            ASSERT_EQUAL(words, expected_words);
+            ASSERT(status == expected_status);
+        }
+    }
+    ASSERT_EQUAL(counting.GetBytesInUse(), 0u);
+}
+
+size_t SumMemoryStats(const MemoryStats& stats) {
+    return stats.inverted_index + stats.status_partitions + stats.forward_index + stats.positions + stats.document_text
+        + stats.dictionary + stats.stop_words + stats.documents + stats.impact_index + stats.posting_tiers + stats.hot_terms;
+}
+
+// Every structure grows when documents are added; all but the stored texts and the dictionary
+// shrink when documents are removed
+void TestMemoryStatsFollowDocuments() {
+    SearchServerOptions options;
+    options.store_positions = true;
+    options.partition_by_status = true;
+    options.quantize_impacts = true;
+    options.tiered_postings = true;
+    options.hot_term_count = 2;
+    SearchServer search_server("and in at"s, options);
+
+    const MemoryStats empty = search_server.GetMemoryStats();
+    ASSERT_EQUAL(empty.total, SumMemoryStats(empty));
+    ASSERT(empty.stop_words > 0);
+    ASSERT_EQUAL(empty.inverted_index, 0u);
+    ASSERT_EQUAL(empty.status_partitions, 0u);
+    ASSERT_EQUAL(empty.document_text, 0u);
+    ASSERT_EQUAL(empty.documents, 0u);
+    ASSERT_EQUAL(empty.posting_tiers, 0u);
+    ASSERT_EQUAL(empty.hot_terms, 0u);
+
+    const auto texts = GenerateTestTexts(34, 1200, 10, 40);
+    AddTestDocuments(search_server, texts, true);
+    for (int i = 0; i < 3; ++i) {
+        search_server.FindTopDocuments("w0"s);
+    }
+    const MemoryStats full = search_server.GetMemoryStats();
+    ASSERT_EQUAL(full.total, SumMemoryStats(full));
+    ASSERT(full.inverted_index > empty.inverted_index);
+    ASSERT(full.status_partitions > empty.status_partitions);
+    ASSERT(full.forward_index > empty.forward_index);
+    ASSERT(full.positions > empty.positions);
+    ASSERT(full.document_text > empty.document_text);
+    ASSERT(full.dictionary > empty.dictionary);
+    ASSERT_EQUAL(full.stop_words, empty.stop_words);
+    ASSERT(full.documents > empty.documents);
+    ASSERT(full.impact_index > empty.impact_index);
+    ASSERT(full.posting_tiers > empty.posting_tiers);
+    ASSERT(full.hot_terms > empty.hot_terms);
+
+    // More than half of the forward index becomes garbage, so it is compacted
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (i % 3 != 0) {
+            search_server.RemoveDocument(static_cast<int>(i) * 2 + 1);
+        }
+    }
+    const MemoryStats third = search_server.GetMemoryStats();
+    ASSERT_EQUAL(third.total, SumMemoryStats(third));
+    ASSERT(third.inverted_index < full.inverted_index);
+    ASSERT(third.status_partitions < full.status_partitions);
+    ASSERT(third.forward_index < full.forward_index);
+    ASSERT(third.positions < full.positions);
+    // Texts are kept while the dictionary points into them
+    ASSERT_EQUAL(third.document_text, full.document_text);
+    ASSERT(third.dictionary <= full.dictionary);
+    ASSERT(third.documents < full.documents);
+    ASSERT(third.impact_index < full.impact_index);
+    ASSERT(third.posting_tiers < full.posting_tiers);
+    ASSERT(third.total < full.total);
+
+    for (size_t i = 0; i < texts.size(); i += 3) {
+        search_server.RemoveDocument(static_cast<int>(i) * 2 + 1);
+    }
+    const MemoryStats removed = search_server.GetMemoryStats();
+    ASSERT_EQUAL(removed.total, SumMemoryStats(removed));
+    // Words keep their empty posting lists and tiers
+    ASSERT(removed.inverted_index < third.inverted_index);
+    ASSERT(removed.status_partitions < third.status_partitions);
+    ASSERT_EQUAL(removed.forward_index, 0u);
+    ASSERT_EQUAL(removed.positions, 0u);
+    ASSERT_EQUAL(removed.documents, 0u);
+    ASSERT(removed.posting_tiers < third.posting_tiers);
+    ASSERT(removed.total < third.total);
+}
+
+} // namespace
+
+void RunMemoryTests(TestRunner& tr) {
+    RUN_TEST(tr, TestPoolServerEqualsDefaultServer);
+    RUN_TEST(tr, TestMemoryStatsFollowDocuments);
+}
@@ -0,0 +1,77 @@
+#include "tests.h"
+
+#include "../near_duplicates.h"
+
+using namespace std;
+
+namespace {
+
+void TestNearDuplicatesAreClustered() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "nasty rat and funny pet"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(4, "big dog starling"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(5, "funny pet nasty rat rat"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(FindNearDuplicates(search_server), (vector<vector<int>>{ { 1, 3, 5 } }));
+
+    RemoveNearDuplicates(search_server);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+    ASSERT(search_server.GetWordFrequencies(1).size() > 0);
+    ASSERT(search_server.GetWordFrequencies(3).empty());
+}
+
+// Documents of a pair differ by one word each, so they share a bucket only when all its rows come
+// from the common words. Many dissimilar documents with smaller ids have the same rows, so the
+// pair is found only when its two members are compared with each other, not with the first one
+void TestPairsWithoutBucketLeaderAreFound() {
+    string common;
+    for (int i = 0; i < 20; ++i) {
+        common += " w"s + to_string(i);
+    }
+    SearchServer search_server(""s);
+    for (int id = 1; id <= 200; ++id) {
+        string text = common;
+        for (const char prefix : "abcdef"s) {
+            text += ' ' + string(1, prefix) + to_string(id);
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+    }
+    search_server.AddDocument(1000, common + " x"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(1001, common + " y"s, DocumentStatus::ACTUAL, { 1 });
+    NearDuplicateOptions options;
+    options.jaccard_threshold = 0.8;
+    ASSERT_EQUAL(FindNearDuplicates(search_server, options), (vector<vector<int>>{ { 1000, 1001 } }));
+}
+
+// Copies of one text share the bucket of every band. Each copy is compared once with the first
+// one, later bands find them in one cluster already, so the cost grows linearly with the bucket
+void TestLargeBucketIsComparedLinearly() {
+    SearchServer search_server(""s);
+    const int copy_count = 2000;
+    for (int id = 1; id <= copy_count; ++id) {
+        search_server.AddDocument(id, "funny pet with curly hair and a long tail"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    search_server.AddDocument(copy_count + 1, "big dog starling"s, DocumentStatus::ACTUAL, { 1 });
+    NearDuplicateStats stats;
+    const auto clusters = FindNearDuplicates(search_server, {}, &stats);
+    ASSERT_EQUAL(clusters.size(), 1u);
+    ASSERT_EQUAL(clusters[0].size(), static_cast<size_t>(copy_count));
+    ASSERT_EQUAL(stats.jaccard_computations, static_cast<size_t>(copy_count - 1));
+}
+
+void TestInvalidNearDuplicateOptions() {
+    SearchServer search_server(""s);
+    NearDuplicateOptions options;
+    options.jaccard_threshold = 1.5;
+    ASSERT_THROWS(FindNearDuplicates(search_server, options), invalid_argument);
+}
+
+} // namespace
+
+void RunNearDuplicateTests(TestRunner& tr) {
+    RUN_TEST(tr, TestNearDuplicatesAreClustered);
+    RUN_TEST(tr, TestPairsWithoutBucketLeaderAreFound);
+    RUN_TEST(tr, TestLargeBucketIsComparedLinearly);
+    RUN_TEST(tr, TestInvalidNearDuplicateOptions);
+}
@@ -0,0 +1,124 @@
+#include "tests.h"
+
+#include <forward_list>
+#include <limits>
+#include "../paginator.h"
+#include "../search_server.h"
+
+using namespace std;
+
+namespace {
+
+SearchOptions MakeAllResultsOptions() {
+    SearchOptions options;
+    options.limit = numeric_limits<size_t>::max();
+    return options;
+}
+
+// Walks the results page by page with the cursor of the previous page
+vector<Document> CollectPages(const SearchServer& search_server, const string& query, DocumentStatus status, size_t page_size) {
+    SearchOptions options;
+    options.limit = page_size;
+    vector<Document> documents;
+    while (true) {
+        const SearchResult page = search_server.FindTopDocuments(query, status, options);
+        documents.insert(documents.end(), page.documents.begin(), page.documents.end());
+        if (!page.next_cursor) {
+            return documents;
+        }
+        Assert(page.documents.size() == page_size, "Only the last page may be short"s);
+        options.search_after = DecodeCursor(EncodeCursor(*page.next_cursor));
+    }
+}
+
+void TestCursorPagesEqualFullRanking() {
+    SearchServerOptions server_options;
+    server_options.store_positions = true;
+    SearchServer search_server("w5"s, server_options);
+    AddTestDocuments(search_server, GenerateTestTexts(3, 400, 10, 150));
+    auto queries = GenerateTestQueries(4, 40, 3, 150);
+    // Phrase queries keep every candidate after the cursor until the phrases are checked
+    queries.push_back("\"w1 w2\" w3"s);
+    queries.push_back("+w1 w4 -w9"s);
+    for (const string& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto expected = search_server.FindTopDocuments(query, status, MakeAllResultsOptions()).documents;
+            for (const size_t page_size : { 1, 3, 7 }) {
+                AssertSameDocuments(CollectPages(search_server, query, status, page_size), expected, query);
+            }
+        }
+    }
+}
+
+void TestOffsetAndLimitSliceFullRanking() {
+    SearchServer search_server(""s);
+    AddTestDocuments(search_server, GenerateTestTexts(5, 300, 8, 100), true);
+    for (const string& query : GenerateTestQueries(6, 30, 3, 100)) {
+        const auto expected = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents;
+        AssertSameDocuments(search_server.FindTopDocuments(query),
+            vector<Document>(expected.begin(), expected.begin() + min<size_t>(expected.size(), MAX_RESULT_DOCUMENT_COUNT)), query);
+        for (const size_t offset : { 0, 4, 30 }) {
+            SearchOptions options;
+            options.offset = offset;
+            options.limit = 6;
+            const SearchResult page = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, options);
+            const size_t first = min(offset, expected.size());
+            const size_t last = min(offset + 6, expected.size());
+            AssertSameDocuments(page.documents, vector<Document>(expected.begin() + first, expected.begin() + last), query);
+            ASSERT_EQUAL(page.next_cursor.has_value(), last < expected.size() && last > first);
+        }
+    }
+}
+
+void TestInvalidCursorText() {
+    ASSERT_THROWS(DecodeCursor("not a cursor"sv), invalid_argument);
+    const SearchCursor cursor(Document(7, 0.25, -2));
+    const SearchCursor decoded = DecodeCursor(EncodeCursor(cursor));
+    ASSERT_EQUAL(decoded.id, 7);
+    ASSERT_EQUAL(decoded.rating, -2);
+    ASSERT_EQUAL(decoded.relevance, 0.25);
+}
+
+// Values of every page in the order the lazy paginator visits them
+template <typename Container>
+vector<vector<int>> CollectPaginatorPages(const Container& values, size_t page_size) {
+    const auto pages = Paginate(values, page_size);
+    vector<vector<int>> result;
+    for (const auto page : pages) {
+        result.emplace_back(page.begin(), page.end());
+        ASSERT_EQUAL(page.size(), result.back().size());
+    }
+    ASSERT_EQUAL(pages.size(), result.size());
+    return result;
+}
+
+void TestPaginatorPages() {
+    const vector<int> values = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    ASSERT_EQUAL(CollectPaginatorPages(values, 3), (vector<vector<int>>{ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 }, { 10 } }));
+    ASSERT_EQUAL(CollectPaginatorPages(values, 5), (vector<vector<int>>{ { 1, 2, 3, 4, 5 }, { 6, 7, 8, 9, 10 } }));
+    ASSERT_EQUAL(CollectPaginatorPages(values, 20), (vector<vector<int>>{ values }));
+    ASSERT_EQUAL(CollectPaginatorPages(vector<int>{}, 3).size(), 0u);
+
+    // Forward iterators can not jump, pages are still cut without passing the end
+    const forward_list<int> list(values.begin(), values.end());
+    ASSERT_EQUAL(CollectPaginatorPages(list, 4), (vector<vector<int>>{ { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10 } }));
+
+    const auto pages = Paginate(values, 4);
+    auto it = pages.begin();
+    ASSERT_EQUAL(*(*it++).begin(), 1);
+    ASSERT_EQUAL(*(*it).begin(), 5);
+    ++it;
+    ASSERT(++it == pages.end());
+
+    ASSERT_THROWS(Paginate(values, 0), invalid_argument);
+    ASSERT_THROWS(Paginate(vector<int>{}, 0), invalid_argument);
+}
+
+} // namespace
+
+void RunPaginationTests(TestRunner& tr) {
+    RUN_TEST(tr, TestCursorPagesEqualFullRanking);
+    RUN_TEST(tr, TestOffsetAndLimitSliceFullRanking);
+    RUN_TEST(tr, TestInvalidCursorText);
+    RUN_TEST(tr, TestPaginatorPages);
+}
@@ -0,0 +1,173 @@
+#include "tests.h"
+
+#include <limits>
+#include <numeric>
+#include "../search_server.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+namespace {
+
+vector<Document> FindAll(const SearchServer& search_server, string_view query) {
+    SearchOptions options;
+    options.limit = numeric_limits<size_t>::max();
+    return search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, options).documents;
+}
+
+bool ContainsPhrase(const string& text, const vector<string_view>& phrase) {
+    const auto words = SplitIntoWords(text);
+    return search(words.begin(), words.end(), phrase.begin(), phrase.end()) != words.end();
+}
+
+// A phrase query finds the documents of the same query without quotes which contain the words in a row
+void TestPhraseQueriesFilterPlainQueries() {
+    SearchServerOptions options;
+    options.store_positions = true;
+    SearchServer search_server(""s, options);
+    const auto texts = GenerateTestTexts(7, 500, 12, 30);
+    AddTestDocuments(search_server, texts, true);
+    for (const auto& [phrase_query, plain_query, phrase] : vector<tuple<string, string, vector<string_view>>>{
+        { "\"w0 w1\""s, "w0 w1"s, { "w0"sv, "w1"sv } },
+        { "\"w2 w0 w3\" w5"s, "w2 w0 w3 w5"s, { "w2"sv, "w0"sv, "w3"sv } },
+        { "w4 \"w1 w1\" -w6"s, "w4 w1 -w6"s, { "w1"sv, "w1"sv } },
+        }) {
+        vector<Document> expected;
+        for (const Document& document : FindAll(search_server, plain_query)) {
+            if (ContainsPhrase(texts[document.id / 2], phrase)) {
+                expected.push_back(document);
+            }
+        }
+        ASSERT(!expected.empty());
+        AssertSameDocuments(FindAll(search_server, phrase_query), expected, phrase_query);
+    }
+}
+
+void TestPhraseStopWordsKeepOffsets() {
+    SearchServerOptions options;
+    options.store_positions = true;
+    SearchServer search_server("the"s, options);
+    search_server.AddDocument(1, "cat in the hat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "cat in hat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "cat in a hat"s, DocumentStatus::ACTUAL, { 1 });
+    const auto documents = search_server.FindTopDocuments("\"in the hat\""s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id + documents[1].id, 4);
+
+    ASSERT_THROWS(search_server.FindTopDocuments("\"cat in"s), invalid_argument);
+}
+
+// Without positions quotes stay parts of ordinary words, as they were before phrase queries
+void TestQuotesWithoutPositionsAreWordCharacters() {
+    SearchServer search_server("the"s);
+    search_server.AddDocument(1, "\"cat in\" the hat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "cat in hat"s, DocumentStatus::ACTUAL, { 1 });
+    const auto quoted = search_server.FindTopDocuments("\"cat in\""s);
+    ASSERT_EQUAL(quoted.size(), 1u);
+    ASSERT_EQUAL(quoted[0].id, 1);
+    ASSERT_EQUAL(search_server.FindTopDocuments("\"cat"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("\"hat\""s).size(), 0u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("hat -in\""s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("hat -in\""s)[0].id, 2);
+    const auto [words, status] = search_server.MatchDocument("\"cat in\" hat"s, 1);
+    ASSERT_EQUAL(words.size(), 3u);
+    ASSERT_EQUAL(static_cast<int>(status), static_cast<int>(DocumentStatus::ACTUAL));
+}
+
+// Replaces the words starting with prefix by one word
+string MergeWordsWithPrefix(const string& text, string_view prefix, const string& merged_word) {
+    string result;
+    for (const string_view word : SplitIntoWords(text)) {
+        if (!result.empty()) {
+            result.push_back(' ');
+        }
+        result += word.substr(0, prefix.size()) == prefix ? merged_word : string(word);
+    }
+    return result;
+}
+
+// Expansions of a prefix are scored as a single word, so a prefix query ranks the documents
+// as a plain query does where all the expansions are written as the same word
+void TestPrefixQueriesScoreExpansionsAsOneWord() {
+    SearchServer search_server(""s);
+    SearchServer merged_server(""s);
+    const auto texts = GenerateTestTexts(8, 400, 10, 40);
+    vector<string> merged_texts;
+    for (const string& text : texts) {
+        merged_texts.push_back(MergeWordsWithPrefix(MergeWordsWithPrefix(text, "w1"sv, "plus"s), "w2"sv, "minus"s));
+    }
+    AddTestDocuments(search_server, texts);
+    AddTestDocuments(merged_server, merged_texts);
+    for (const auto& [prefix_query, merged_query] : vector<pair<string, string>>{
+        { "w1*"s, "plus"s },
+        { "w1* w3 w30"s, "plus w3 w30"s },
+        { "w1* -w2*"s, "plus -minus"s },
+        { "w3 w5 -w2*"s, "w3 w5 -minus"s },
+        }) {
+        const auto expected = FindAll(merged_server, merged_query);
+        ASSERT(!expected.empty());
+        AssertSameDocuments(FindAll(search_server, prefix_query), expected, prefix_query);
+    }
+    ASSERT(search_server.FindTopDocuments("nothing*"s).empty());
+}
+
+int ComputeEditDistance(string_view lhs, string_view rhs) {
+    vector<int> row(rhs.size() + 1);
+    iota(row.begin(), row.end(), 0);
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int substitution = diagonal + (lhs[i - 1] == rhs[j - 1] ? 0 : 1);
+            diagonal = row[j];
+            row[j] = min({ row[j] + 1, row[j - 1] + 1, substitution });
+        }
+    }
+    return row.back();
+}
+
+// Every word of the texts within the distance adds its TF-IDF divided by 1 + distance
+void TestFuzzyQueriesEqualBruteForce() {
+    SearchServer search_server(""s);
+    const auto texts = GenerateTestTexts(9, 300, 8, 60);
+    AddTestDocuments(search_server, texts);
+    set<string> dictionary;
+    for (const string& text : texts) {
+        for (const string_view word : SplitIntoWords(text)) {
+            dictionary.insert(string(word));
+        }
+    }
+    for (const auto& [query_word, max_distance, plain_word, minus_word] : vector<tuple<string, int, string, string>>{
+        { "w7"s, 1, ""s, ""s },
+        { "x4"s, 1, "w50"s, ""s },
+        { "w1a"s, 2, ""s, "w5"s },
+        }) {
+        map<string, double> word_weights;
+        for (const string& word : dictionary) {
+            const int distance = ComputeEditDistance(word, query_word);
+            if (distance <= max_distance) {
+                word_weights[word] += 1.0 / (1 + distance);
+            }
+        }
+        if (!plain_word.empty()) {
+            word_weights[plain_word] += 1.0;
+        }
+        string query = query_word + "~"s + to_string(max_distance);
+        query += plain_word.empty() ? ""s : " "s + plain_word;
+        query += minus_word.empty() ? ""s : " -"s + minus_word;
+        const auto expected = RankTestTexts(texts, false, word_weights, minus_word.empty() ? set<string>{} : set<string>{ minus_word });
+        ASSERT(!expected.empty());
+        AssertSameDocuments(FindAll(search_server, query), expected, query);
+    }
+    ASSERT(search_server.FindTopDocuments("zzzzzz~1"s).empty());
+}
+
+} // namespace
+
+void RunQuerySyntaxTests(TestRunner& tr) {
+    RUN_TEST(tr, TestPhraseQueriesFilterPlainQueries);
+    RUN_TEST(tr, TestPhraseStopWordsKeepOffsets);
+    RUN_TEST(tr, TestQuotesWithoutPositionsAreWordCharacters);
+    RUN_TEST(tr, TestPrefixQueriesScoreExpansionsAsOneWord);
+    RUN_TEST(tr, TestFuzzyQueriesEqualBruteForce);
+}
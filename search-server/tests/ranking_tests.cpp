@@ -0,0 +1,289 @@
+#include "tests.h"
+
+#include <cmath>
+#include <execution>
+#include <limits>
+#include "../search_server.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+namespace {
+
+SearchOptions MakeAllResultsOptions() {
+    SearchOptions options;
+    options.limit = numeric_limits<size_t>::max();
+    return options;
+}
+
+// Okapi BM25 of the plus words computed from the texts, documents with a minus word are skipped
+vector<Document> RankTestTextsByBm25(const vector<string>& texts, const vector<string>& plus_words, const set<string>& minus_words) {
+    map<string, int> document_freqs;
+    size_t total_length = 0;
+    for (const string& text : texts) {
+        const auto words = SplitIntoWords(text);
+        total_length += words.size();
+        for (const string_view word : set<string_view>(words.begin(), words.end())) {
+            ++document_freqs[string(word)];
+        }
+    }
+    const double average_length = total_length * 1.0 / texts.size();
+    vector<Document> documents;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const auto words = SplitIntoWords(texts[i]);
+        map<string, int> counts;
+        for (const string_view word : words) {
+            ++counts[string(word)];
+        }
+        if (any_of(minus_words.begin(), minus_words.end(), [&counts](const string& word) { return counts.count(word) > 0; })) {
+            continue;
+        }
+        double relevance = 0.0;
+        bool has_plus_word = false;
+        for (const string& word : plus_words) {
+            const auto count = counts.find(word);
+            if (count == counts.end()) {
+                continue;
+            }
+            has_plus_word = true;
+            const int document_freq = document_freqs.at(word);
+            const double inverse_document_freq = log(1.0 + (texts.size() - document_freq + 0.5) / (document_freq + 0.5));
+            const double length_norm = Bm25Scorer::K1 * (1.0 - Bm25Scorer::B + Bm25Scorer::B * words.size() / average_length);
+            relevance += inverse_document_freq * count->second * (Bm25Scorer::K1 + 1.0) / (count->second + length_norm);
+        }
+        if (has_plus_word) {
+            documents.push_back({ static_cast<int>(i) * 2 + 1, relevance, static_cast<int>(i % 7) - 3 });
+        }
+    }
+    sort(documents.begin(), documents.end(), [](const Document& lhs, const Document& rhs) {
+        if (abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+            return lhs.relevance > rhs.relevance;
+        }
+        return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+        });
+    return documents;
+}
+
+void TestTfIdfEqualsBruteForce() {
+    SearchServer search_server(""s);
+    const auto texts = GenerateTestTexts(10, 300, 10, 80);
+    AddTestDocuments(search_server, texts);
+    const auto expected = RankTestTexts(texts, false, { { "w3"s, 1.0 }, { "w17"s, 1.0 }, { "w40"s, 1.0 } }, { "w9"s });
+    AssertSameDocuments(search_server.FindTopDocuments("w3 w17 w40 -w9"s, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents,
+        expected, "tf-idf"s);
+    AssertSameDocuments(search_server.FindTopDocuments(execution::par, "w3 w17 w40 -w9"s),
+        vector<Document>(expected.begin(), expected.begin() + MAX_RESULT_DOCUMENT_COUNT), "tf-idf par"s);
+}
+
+void TestBm25EqualsBruteForce() {
+    SearchServer search_server(""s);
+    const auto texts = GenerateTestTexts(11, 300, 14, 80);
+    AddTestDocuments(search_server, texts, true);
+    const auto expected = RankTestTextsByBm25(texts, { "w3"s, "w17"s, "w40"s }, { "w9"s });
+    ASSERT(expected.size() > MAX_RESULT_DOCUMENT_COUNT);
+    AssertSameDocuments(search_server.FindTopDocuments<Bm25Scorer>("w3 w17 w40 -w9"s, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents,
+        expected, "bm25"s);
+    AssertSameDocuments(search_server.FindTopDocuments<Bm25Scorer>("w3 w17 w40 -w9"s),
+        vector<Document>(expected.begin(), expected.begin() + MAX_RESULT_DOCUMENT_COUNT), "bm25 top"s);
+}
+
+// Quantized impacts find the same documents as the exact TF-IDF, the relevance differs by
+// the 16-bit quantization and by idf drift between requantizations
+void TestQuantizedImpactsFindExactDocuments() {
+    SearchServerOptions options;
+    options.quantize_impacts = true;
+    SearchServer search_server("w0"s, options);
+    const auto texts = GenerateTestTexts(16, 600, 10, 120);
+    AddTestDocuments(search_server, texts);
+    for (int id = 5; id < 1200; id += 14) {
+        search_server.RemoveDocument(id);
+    }
+    for (const string& query : GenerateTestQueries(17, 40, 3, 120)) {
+        auto exact = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents;
+        auto quantized = search_server.FindTopDocuments<QuantizedTfIdfScorer>(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents;
+        ASSERT_EQUAL(quantized.size(), exact.size());
+        if (exact.empty()) {
+            continue;
+        }
+        const double tolerance = exact.front().relevance * 0.05;
+        auto by_id = [](const Document& lhs, const Document& rhs) { return lhs.id < rhs.id; };
+        sort(exact.begin(), exact.end(), by_id);
+        sort(quantized.begin(), quantized.end(), by_id);
+        for (size_t i = 0; i < exact.size(); ++i) {
+            ASSERT_EQUAL(quantized[i].id, exact[i].id);
+            Assert(abs(quantized[i].relevance - exact[i].relevance) <= tolerance, query + ": relevance of "s + to_string(exact[i].id));
+        }
+    }
+    SearchServer exact_server(""s);
+    ASSERT_THROWS(exact_server.FindTopDocuments<QuantizedTfIdfScorer>("w1"s), logic_error);
+}
+
+// Quantized TF-IDF of the ACTUAL documents right after requantization, sorted by id: every
+// tf * idf is rounded to a multiple of the scale which maps the largest one to 65535
+vector<Document> RankByFreshImpacts(const SearchServer& search_server, const string& query) {
+    map<string, int> document_freqs;
+    for (const int document_id : search_server) {
+        for (const auto [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            ++document_freqs[string(word)];
+        }
+    }
+    auto get_impact = [&](string_view word, double freq) {
+        return freq * log(search_server.GetDocumentCount() * 1.0 / document_freqs.at(string(word)));
+    };
+    double max_impact = 0.0;
+    for (const int document_id : search_server) {
+        for (const auto [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            max_impact = max(max_impact, get_impact(word, freq));
+        }
+    }
+    const double scale = max_impact / numeric_limits<uint16_t>::max();
+
+    set<string_view> plus_words;
+    set<string_view> minus_words;
+    for (const string_view word : SplitIntoWords(query)) {
+        if (word[0] == '-') {
+            minus_words.insert(word.substr(1));
+        }
+        else {
+            plus_words.insert(word);
+        }
+    }
+    vector<Document> documents;
+    for (const int document_id : search_server) {
+        uint32_t score = 0;
+        bool has_minus_word = false;
+        for (const auto [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            if (minus_words.count(word) > 0) {
+                has_minus_word = true;
+            }
+            else if (plus_words.count(word) > 0) {
+                score += static_cast<uint32_t>(clamp(round(get_impact(word, freq) / scale), 1.0, 65535.0));
+            }
+        }
+        if (score > 0 && !has_minus_word) {
+            documents.push_back({ document_id, score * scale, 0 });
+        }
+    }
+    return documents;
+}
+
+void AssertSameImpactRanking(vector<Document> actual, const vector<Document>& expected, const string& hint) {
+    for (size_t i = 1; i < actual.size(); ++i) {
+        Assert(actual[i - 1].relevance >= actual[i].relevance, hint + ": ranking order"s);
+    }
+    sort(actual.begin(), actual.end(), [](const Document& lhs, const Document& rhs) { return lhs.id < rhs.id; });
+    AssertEqual(actual.size(), expected.size(), hint + ": document count"s);
+    for (size_t i = 0; i < actual.size(); ++i) {
+        AssertEqual(actual[i].id, expected[i].id, hint);
+        AssertEqual(actual[i].relevance, expected[i].relevance, hint + ": relevance of "s + to_string(actual[i].id));
+    }
+}
+
+// Reordering renumbers the documents of the impact index only: quantized queries find the same ids with
+// the same relevance as a fresh quantization, exact queries do not change, and the posting gaps shrink
+void TestReorderedImpactsKeepResults() {
+    SearchServerOptions options;
+    options.quantize_impacts = true;
+    SearchServer search_server(""s, options);
+    SearchServer plain_server(""s, options);
+    const auto texts = GenerateTestTexts(19, 1000, 10, 200);
+    AddTestDocuments(search_server, texts, true);
+    AddTestDocuments(plain_server, texts, true);
+    const auto queries = GenerateTestQueries(20, 40, 3, 200);
+    const PostingGapStats plain_gaps = plain_server.GetPostingGapStats();
+
+    search_server.ReorderDocuments();
+    ASSERT(search_server.GetPostingGapStats().average_log2_gap < plain_gaps.average_log2_gap);
+    ASSERT_EQUAL(search_server.GetPostingGapStats().gap_count, plain_gaps.gap_count);
+    map<string, vector<Document>> expected;
+    for (const string& query : queries) {
+        expected[query] = RankByFreshImpacts(search_server, query);
+        AssertSameImpactRanking(search_server.FindTopDocuments<QuantizedTfIdfScorer>(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents,
+            expected[query], query);
+        AssertIdenticalDocuments(search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents,
+            plain_server.FindTopDocuments(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents, query);
+    }
+
+    // Too few changes for a requantization: the rest keep their impacts, new documents follow the reordered ones
+    set<int> removed_ids;
+    for (int id = 1; id < 2000; id += 40) {
+        search_server.RemoveDocument(id);
+        removed_ids.insert(id);
+    }
+    search_server.AddDocument(5001, "w1 zebra"s, DocumentStatus::ACTUAL, { 1 });
+    for (const string& query : queries) {
+        vector<Document> remaining;
+        for (const Document& document : expected[query]) {
+            if (removed_ids.count(document.id) == 0) {
+                remaining.push_back(document);
+            }
+        }
+        auto actual = search_server.FindTopDocuments<QuantizedTfIdfScorer>(query, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents;
+        actual.erase(remove_if(actual.begin(), actual.end(), [](const Document& document) { return document.id == 5001; }), actual.end());
+        AssertSameImpactRanking(actual, remaining, query);
+    }
+    const auto zebra = search_server.FindTopDocuments<QuantizedTfIdfScorer>("zebra"s);
+    ASSERT_EQUAL(zebra.size(), 1u);
+    ASSERT_EQUAL(zebra[0].id, 5001);
+
+    SearchServer exact_server(""s);
+    ASSERT_THROWS(exact_server.ReorderDocuments(), logic_error);
+}
+
+// Relevance of an OR-mode query is the sum of the word scores in the sorted order of the words,
+// so it is the same to the last bit whatever order the planner scans the posting lists in
+void TestOrModeRelevanceIsSummedInWordOrder() {
+    SearchServer search_server(""s);
+    const auto texts = GenerateTestTexts(18, 1000, 12, 150);
+    AddTestDocuments(search_server, texts, true);
+    const auto queries = GenerateTestQueries(19, 60, 6, 150);
+    const auto batch_results = search_server.FindTopDocumentsBatch(execution::seq, queries);
+    SearchOptions budget_options = MakeAllResultsOptions();
+    budget_options.max_postings = 1'000'000'000;
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const string& query = queries[i];
+        set<string> plus_words;
+        set<int> minus_document_ids;
+        for (const string_view word : SplitIntoWords(query)) {
+            if (word[0] != '-') {
+                plus_words.insert(string(word));
+                continue;
+            }
+            for (const Document& document : search_server.FindTopDocuments(word.substr(1), DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents) {
+                minus_document_ids.insert(document.id);
+            }
+        }
+        // A single-word query returns the score of the word itself
+        map<int, double> expected;
+        for (const string& word : plus_words) {
+            for (const Document& document : search_server.FindTopDocuments(word, DocumentStatus::ACTUAL, MakeAllResultsOptions()).documents) {
+                if (minus_document_ids.count(document.id) == 0) {
+                    expected[document.id] += document.relevance;
+                }
+            }
+        }
+
+        const auto exhaustive = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, MakeAllResultsOptions());
+        const auto within_budget = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, budget_options);
+        ASSERT(!within_budget.is_approximate);
+        for (const auto* documents : { &exhaustive.documents, &within_budget.documents, &batch_results[i] }) {
+            if (documents != &batch_results[i]) {
+                ASSERT_EQUAL(documents->size(), expected.size());
+            }
+            for (const Document& document : *documents) {
+                AssertEqual(document.relevance, expected.at(document.id), query + ": relevance of "s + to_string(document.id));
+            }
+        }
+    }
+}
+
+} // namespace
+
+void RunRankingTests(TestRunner& tr) {
+    RUN_TEST(tr, TestTfIdfEqualsBruteForce);
+    RUN_TEST(tr, TestBm25EqualsBruteForce);
+    RUN_TEST(tr, TestQuantizedImpactsFindExactDocuments);
+    RUN_TEST(tr, TestReorderedImpactsKeepResults);
+    RUN_TEST(tr, TestOrModeRelevanceIsSummedInWordOrder);
+}
@@ -0,0 +1,98 @@
+#include "tests.h"
+
+#include <thread>
+#include "../request_queue.h"
+
+using namespace std;
+
+namespace {
+
+const int WINDOW_SIZE = 1440;
+
+SearchServer MakeRequestQueueServer() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "curly cat and curly tail"s, DocumentStatus::ACTUAL, { 7 });
+    search_server.AddDocument(2, "big dog and fancy collar"s, DocumentStatus::ACTUAL, { 2 });
+    return search_server;
+}
+
+// Only the last WINDOW_SIZE requests are counted once the ring wraps
+void TestRequestQueueWindow() {
+    const SearchServer search_server = MakeRequestQueueServer();
+    RequestQueue request_queue(search_server);
+    ASSERT_EQUAL(request_queue.GetStats().requests, 0);
+    for (int i = 0; i < WINDOW_SIZE - 1; ++i) {
+        request_queue.AddFindRequest("empty request"s);
+    }
+    request_queue.AddFindRequest("curly dog"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), WINDOW_SIZE - 1);
+
+    for (int i = 0; i < 100; ++i) {
+        request_queue.AddFindRequest("curly dog"s);
+    }
+    request_queue.AddFindRequest("big collar"s, DocumentStatus::ACTUAL);
+    request_queue.AddFindRequest("sparrow"s, [](int, DocumentStatus, int) { return true; });
+    const RequestStats stats = request_queue.GetStats();
+    ASSERT_EQUAL(stats.requests, WINDOW_SIZE);
+    ASSERT_EQUAL(stats.no_result_requests, WINDOW_SIZE - 102);
+    ASSERT_EQUAL(stats.hit_requests, 102);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), WINDOW_SIZE - 102);
+    ASSERT(stats.average_latency.count() > 0);
+}
+
+// Writers of empty and found requests race over the ring while a reader checks that every
+// snapshot describes at most one window
+void TestRequestQueueConcurrentRequests() {
+    const SearchServer search_server = MakeRequestQueueServer();
+    RequestQueue request_queue(search_server);
+    const int writer_count = 8;
+    const int requests_per_writer = 2000;
+    atomic<bool> is_writing{ true };
+    atomic<int> bad_snapshots{ 0 };
+    thread reader([&] {
+        while (is_writing.load()) {
+            const RequestStats stats = request_queue.GetStats();
+            if (stats.requests > WINDOW_SIZE || stats.no_result_requests < 0 || stats.hit_requests < 0
+                || stats.no_result_requests + stats.hit_requests != stats.requests) {
+                ++bad_snapshots;
+            }
+        }
+        });
+    vector<thread> writers;
+    for (int i = 0; i < writer_count; ++i) {
+        writers.emplace_back([&request_queue, i] {
+            for (int j = 0; j < requests_per_writer; ++j) {
+                request_queue.AddFindRequest(i % 2 == 0 ? "sparrow"s : "curly cat"s);
+            }
+            });
+    }
+    for (thread& writer : writers) {
+        writer.join();
+    }
+    is_writing = false;
+    reader.join();
+
+    ASSERT_EQUAL(bad_snapshots.load(), 0);
+    const RequestStats stats = request_queue.GetStats();
+    ASSERT_EQUAL(stats.requests, WINDOW_SIZE);
+    ASSERT_EQUAL(stats.no_result_requests + stats.hit_requests, WINDOW_SIZE);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), stats.no_result_requests);
+
+    // The running totals did not drift during the race: a window of known requests is counted exactly
+    for (int i = 0; i < WINDOW_SIZE; ++i) {
+        request_queue.AddFindRequest("sparrow"s);
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), WINDOW_SIZE);
+    for (int i = 0; i < WINDOW_SIZE / 2; ++i) {
+        request_queue.AddFindRequest("curly cat"s);
+    }
+    ASSERT_EQUAL(request_queue.GetStats().hit_requests, WINDOW_SIZE / 2);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), WINDOW_SIZE / 2);
+}
+
+} // namespace
+
+void RunRequestQueueTests(TestRunner& tr) {
+    RUN_TEST(tr, TestRequestQueueWindow);
+    RUN_TEST(tr, TestRequestQueueConcurrentRequests);
+}
@@ -0,0 +1,132 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include "../search_metrics.h"
+
+using namespace std;
+
+namespace {
+
+// Every value lands in a bucket whose lower bound is within 1/16 below it
+void TestLatencyHistogramBuckets() {
+    for (int i = 0; i < LatencyHistogram::bucket_count_; ++i) {
+        ASSERT_EQUAL(LatencyHistogram::GetBucketIndex(LatencyHistogram::GetBucketLowerBound(i)), i);
+    }
+    for (uint64_t value = 0; value < 16; ++value) {
+        ASSERT_EQUAL(LatencyHistogram::GetBucketLowerBound(LatencyHistogram::GetBucketIndex(value)), value);
+    }
+    vector<uint64_t> values = { 16, 17, 31, 32, 1000, 123456789, UINT64_MAX };
+    for (uint64_t value = 1; value != 0; value <<= 1) {
+        values.push_back(value - 1);
+        values.push_back(value + value / 3);
+    }
+    for (const uint64_t value : values) {
+        const uint64_t lower_bound = LatencyHistogram::GetBucketLowerBound(LatencyHistogram::GetBucketIndex(value));
+        ASSERT(lower_bound <= value);
+        ASSERT(value - lower_bound <= value / 16);
+    }
+}
+
+void TestLatencyHistogramQuantiles() {
+    LatencyHistogram empty;
+    ASSERT_EQUAL(empty.GetCount(), 0u);
+    ASSERT_EQUAL(empty.GetMin(), 0u);
+    ASSERT_EQUAL(empty.GetValueAtQuantile(0.5), 0u);
+
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value);
+    }
+    ASSERT_EQUAL(histogram.GetCount(), 1000u);
+    ASSERT_EQUAL(histogram.GetMin(), 1u);
+    ASSERT_EQUAL(histogram.GetMax(), 1000u);
+    ASSERT_EQUAL(histogram.GetMean(), 500.5);
+    ASSERT_EQUAL(histogram.GetValueAtQuantile(0.0), 1u);
+    for (const double quantile : { 0.01, 0.5, 0.9, 0.99, 1.0 }) {
+        const uint64_t exact = static_cast<uint64_t>(quantile * 1000 + 0.5);
+        const uint64_t value = histogram.GetValueAtQuantile(quantile);
+        ASSERT(value <= exact);
+        ASSERT(exact - value <= exact / 16);
+    }
+    ASSERT_EQUAL(histogram.GetValueAtQuantile(0.5), 496u);
+    ASSERT_EQUAL(histogram.GetValueAtQuantile(0.99), 960u);
+
+    // Two halves merged give the same histogram as recording everything into one
+    LatencyHistogram low;
+    LatencyHistogram high;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        (value <= 300 ? low : high).Record(value);
+    }
+    low.Merge(high);
+    ASSERT_EQUAL(low.GetCount(), histogram.GetCount());
+    ASSERT_EQUAL(low.GetMin(), histogram.GetMin());
+    ASSERT_EQUAL(low.GetMax(), histogram.GetMax());
+    ASSERT_EQUAL(low.GetMean(), histogram.GetMean());
+    for (const double quantile : { 0.1, 0.5, 0.9, 0.99 }) {
+        ASSERT_EQUAL(low.GetValueAtQuantile(quantile), histogram.GetValueAtQuantile(quantile));
+    }
+}
+
+// Shards of finished threads are merged into the snapshot
+void TestSearchMetricsMergeThreads() {
+    ResetSearchMetrics();
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([i] {
+            for (uint64_t value = 1; value <= 100; ++value) {
+                RecordSearchStage(SearchStage::MATCH, value * (i + 1));
+            }
+            AddSearchCounter(SearchCounter::CANDIDATES_SCORED, 10);
+            });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    const SearchMetrics metrics = GetSearchMetrics();
+    const LatencyHistogram& match = metrics.stages[static_cast<size_t>(SearchStage::MATCH)];
+    ASSERT_EQUAL(match.GetCount(), 400u);
+    ASSERT_EQUAL(match.GetMin(), 1u);
+    ASSERT_EQUAL(match.GetMax(), 400u);
+    ASSERT_EQUAL(match.GetMean(), 126.25);
+    ASSERT_EQUAL(metrics.counters[static_cast<size_t>(SearchCounter::CANDIDATES_SCORED)], 40u);
+
+    ResetSearchMetrics();
+    const SearchMetrics reset_metrics = GetSearchMetrics();
+    ASSERT_EQUAL(reset_metrics.stages[static_cast<size_t>(SearchStage::MATCH)].GetCount(), 0u);
+    ASSERT_EQUAL(reset_metrics.counters[static_cast<size_t>(SearchCounter::CANDIDATES_SCORED)], 0u);
+}
+
+void TestSearchMetricsExport() {
+    SearchMetrics metrics;
+    for (const uint64_t value : { 100, 200, 300 }) {
+        metrics.stages[static_cast<size_t>(SearchStage::QUERY)].Record(value);
+    }
+    metrics.counters[static_cast<size_t>(SearchCounter::BUDGET_EXHAUSTED)] = 5;
+
+    ostringstream text;
+    PrintSearchMetrics(text, metrics);
+    ASSERT(text.str().find("parse: count = 0, min = 0 ns, mean = 0 ns, p50 = 0 ns, p90 = 0 ns, p99 = 0 ns, max = 0 ns\n"s) == 0);
+    ASSERT(text.str().find("\nquery: count = 3, min = 100 ns, mean = 200 ns, p50 = 200 ns, p90 = 288 ns, p99 = 288 ns, max = 300 ns\n"s) != string::npos);
+    ASSERT(text.str().find("\nbudget_exhausted: 5\n"s) != string::npos);
+
+    ostringstream json;
+    PrintSearchMetricsJson(json, metrics);
+    const string output = json.str();
+    ASSERT(output.find("{\"stages\":{\"parse\":{\"count\":0,"s) == 0);
+    ASSERT(output.find("\"query\":{\"count\":3,\"min_ns\":100,\"mean_ns\":200,\"p50_ns\":200,\"p90_ns\":288,\"p99_ns\":288,\"max_ns\":300}},"s) != string::npos);
+    ASSERT(output.find("\"counters\":{\"postings_touched\":0,"s) != string::npos);
+    ASSERT_EQUAL(output.substr(output.size() - 23), "\"budget_exhausted\":5}}\n"s);
+    ASSERT_EQUAL(output.find(",}"s), string::npos);
+    ASSERT_EQUAL(count(output.begin(), output.end(), '{'), count(output.begin(), output.end(), '}'));
+}
+
+} // namespace
+
+void RunSearchMetricsTests(TestRunner& tr) {
+    RUN_TEST(tr, TestLatencyHistogramBuckets);
+    RUN_TEST(tr, TestLatencyHistogramQuantiles);
+    RUN_TEST(tr, TestSearchMetricsMergeThreads);
+    RUN_TEST(tr, TestSearchMetricsExport);
+}
@@ -0,0 +1,246 @@
+#include "tests.h"
+
+#include <execution>
+#include <limits>
+#include "../process_queries.h"
+#include "../search_server.h"
+#include "../string_processing.h"
+
+using namespace std;
+
+namespace {
+
+// Pages which the shortcut paths must return exactly as the exhaustive search does
+vector<SearchOptions> MakeTestPages() {
+    vector<SearchOptions> pages(4);
+    pages[1].offset = 3;
+    pages[1].limit = 4;
+    pages[2].limit = numeric_limits<size_t>::max();
+    // offset + limit does not fit into size_t, the page still has no end
+    pages[3].offset = 2;
+    pages[3].limit = numeric_limits<size_t>::max();
+    return pages;
+}
+
+void AssertSamePages(const SearchServer& search_server, const SearchServer& exact_server, const vector<string>& queries,
+    DocumentStatus status) {
+    for (const string& query : queries) {
+        for (const SearchOptions& page : MakeTestPages()) {
+            const auto expected = exact_server.FindTopDocuments(query, status, page);
+            const auto actual = search_server.FindTopDocuments(query, status, page);
+            const string hint = query + " offset "s + to_string(page.offset);
+            AssertSameDocuments(actual.documents, expected.documents, hint);
+            ASSERT_EQUAL(actual.next_cursor.has_value(), expected.next_cursor.has_value());
+        }
+    }
+}
+
+// Frequent words have long posting lists with a few documents of a large tf, so most
+// short queries are answered from the tiers alone
+void TestTieredPostingsEqualExactSearch() {
+    SearchServerOptions options;
+    options.tiered_postings = true;
+    SearchServer search_server(""s, options);
+    SearchServer exact_server(""s);
+    const auto texts = GenerateTestTexts(20, 3000, 10, 200);
+    AddTestDocuments(search_server, texts);
+    AddTestDocuments(exact_server, texts);
+    for (int id = 1; id < 6000; id += 10) {
+        search_server.RemoveDocument(id);
+        exact_server.RemoveDocument(id);
+    }
+    vector<string> queries = { "w0"s, "w1"s, "w0 w1"s, "w2 -w0"s, "w3 w150"s, "w199"s, "unknown"s };
+    for (const string& query : GenerateTestQueries(21, 20, 2, 200)) {
+        queries.push_back(query);
+    }
+    AssertSamePages(search_server, exact_server, queries, DocumentStatus::ACTUAL);
+    AssertSamePages(search_server, exact_server, queries, DocumentStatus::BANNED);
+
+    // Every tried query is a hit or a fallback, whether metrics are compiled in or not
+    const TierStats stats = search_server.GetTierStats();
+    ASSERT(stats.hits > 0);
+    ASSERT(stats.fallbacks > 0);
+    ASSERT(stats.hits + stats.fallbacks <= 2 * queries.size() * MakeTestPages().size());
+    ASSERT_EQUAL(exact_server.GetTierStats().hits + exact_server.GetTierStats().fallbacks, 0u);
+}
+
+// Single-word queries of frequent words are answered from the hot term cache, which must
+// follow every AddDocument, RemoveDocument and SetDocumentStatus
+void TestHotTermCacheEqualsExactSearch() {
+    SearchServerOptions options;
+    options.hot_term_count = 3;
+    SearchServer search_server(""s, options);
+    SearchServer exact_server(""s);
+    const auto texts = GenerateTestTexts(22, 3000, 10, 200);
+    AddTestDocuments(search_server, texts);
+    AddTestDocuments(exact_server, texts);
+    const vector<string> queries = { "w0"s, "w1"s, "w2"s, "w3"s, "w4"s, "w0"s, "w199"s, "w0 w1"s, "+w0"s };
+    for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+        AssertSamePages(search_server, exact_server, queries, status);
+    }
+    ASSERT(search_server.GetHotTermStats().hits > 0);
+    ASSERT(search_server.GetHotTermStats().cached_terms <= 3u);
+
+    for (int id = 1; id < 6000; id += 6) {
+        search_server.RemoveDocument(id);
+        exact_server.RemoveDocument(id);
+    }
+    for (int id = 3; id < 6000; id += 10) {
+        if (exact_server.GetWordFrequencies(id).size() > 0) {
+            search_server.SetDocumentStatus(id, DocumentStatus::IRRELEVANT);
+            exact_server.SetDocumentStatus(id, DocumentStatus::IRRELEVANT);
+        }
+    }
+    search_server.AddDocument(10001, "w0 w0 w0 w1"s, DocumentStatus::ACTUAL, { 5 });
+    exact_server.AddDocument(10001, "w0 w0 w0 w1"s, DocumentStatus::ACTUAL, { 5 });
+    for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+        AssertSamePages(search_server, exact_server, queries, status);
+    }
+}
+
+// Shared scans give every query of the batch exactly the documents of its own search,
+// queries which can not share them are searched one by one
+void TestBatchEqualsSingleQueries() {
+    const auto texts = GenerateTestTexts(23, 1500, 10, 200);
+    auto queries = GenerateTestQueries(24, 60, 3, 200);
+    queries.insert(queries.end(), { "w1"s, "w1 w1 w2"s, "w2 w1"s, "in the"s, "-w1"s, "w3 -w3"s, "unknown w5"s,
+        "+w1 w2"s, "w1* -w10"s, "w3 w5~1"s, "\"w1 w2\" w3"s });
+    // Every query is in the batch twice
+    const vector<string> first_queries = queries;
+    queries.insert(queries.end(), first_queries.begin(), first_queries.end());
+
+    for (const bool partition_by_status : { false, true }) {
+        SearchServerOptions options;
+        options.store_positions = true;
+        options.partition_by_status = partition_by_status;
+        SearchServer search_server("in the"s, options);
+        AddTestDocuments(search_server, texts);
+        for (int id = 1; id < 3000; id += 8) {
+            search_server.RemoveDocument(id);
+        }
+
+        const auto sequential = search_server.FindTopDocumentsBatch(execution::seq, queries);
+        const auto parallel = search_server.FindTopDocumentsBatch(execution::par, queries);
+        const auto batched = ProcessQueriesBatched(search_server, queries);
+        const auto single = ProcessQueries(search_server, queries);
+        ASSERT_EQUAL(sequential.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = search_server.FindTopDocuments(queries[i]);
+            AssertIdenticalDocuments(sequential[i], expected, queries[i]);
+            AssertIdenticalDocuments(parallel[i], expected, queries[i]);
+            AssertIdenticalDocuments(batched[i], expected, queries[i]);
+            AssertIdenticalDocuments(single[i], expected, queries[i]);
+        }
+        ASSERT_THROWS(search_server.FindTopDocumentsBatch(execution::seq, vector<string>{ "w1"s, "w2 --w3"s }), invalid_argument);
+    }
+}
+
+// A query cut short by max_postings returns real matches of the exact search with a relevance which
+// is never larger, in the same ranking order. The rarest word is read first, so once its postings
+// fit into the budget every document with it is found. A budget which covers all postings is exact
+void TestBudgetExhaustedQueryIsPartial() {
+    const auto texts = GenerateTestTexts(25, 2000, 10, 150);
+    SearchServer search_server(""s);
+    AddTestDocuments(search_server, texts);
+    map<string_view, size_t> document_freqs;
+    map<int, set<string_view>> document_words;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const auto words = SplitIntoWords(texts[i]);
+        set<string_view>& unique_words = document_words[static_cast<int>(i) * 2 + 1];
+        unique_words.insert(words.begin(), words.end());
+        for (const string_view word : unique_words) {
+            ++document_freqs[word];
+        }
+    }
+
+    auto queries = GenerateTestQueries(26, 20, 3, 150);
+    queries.push_back("w0 w1 w149 -w2"s);
+    for (const string& query : queries) {
+        set<string_view> plus_words;
+        for (const string_view word : SplitIntoWords(query)) {
+            if (word[0] != '-' && document_freqs.count(word) > 0) {
+                plus_words.insert(word);
+            }
+        }
+        size_t total_postings = 0;
+        string_view rarest_word;
+        for (const string_view word : plus_words) {
+            total_postings += document_freqs.at(word);
+            if (rarest_word.empty() || document_freqs.at(word) < document_freqs.at(rarest_word)) {
+                rarest_word = word;
+            }
+        }
+        if (total_postings < 4) {
+            continue;
+        }
+
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            SearchOptions options;
+            options.limit = numeric_limits<size_t>::max();
+            const auto exact = search_server.FindTopDocuments(query, status, options).documents;
+            map<int, double> exact_relevance;
+            for (const Document& document : exact) {
+                exact_relevance[document.id] = document.relevance;
+            }
+            for (const size_t max_postings : { size_t{ 1 }, total_postings / 2, total_postings - 1, total_postings, total_postings + 1 }) {
+                options.max_postings = max_postings;
+                const string hint = query + " max_postings "s + to_string(max_postings);
+                const SearchResult result = search_server.FindTopDocuments(query, status, options);
+                AssertEqual(result.is_approximate, max_postings < total_postings, hint);
+                if (!result.is_approximate) {
+                    AssertIdenticalDocuments(result.documents, exact, hint);
+                    continue;
+                }
+                Assert(result.documents.size() <= max_postings, hint);
+                set<int> found_ids;
+                for (size_t i = 0; i < result.documents.size(); ++i) {
+                    const Document& document = result.documents[i];
+                    Assert(exact_relevance.count(document.id) > 0, hint + ": "s + to_string(document.id) + " is not a match"s);
+                    Assert(document.relevance <= exact_relevance.at(document.id) + 1e-12, hint);
+                    if (i > 0) {
+                        Assert(result.documents[i - 1].relevance >= document.relevance, hint + ": ranking order"s);
+                    }
+                    found_ids.insert(document.id);
+                }
+                if (max_postings >= document_freqs.at(rarest_word)) {
+                    for (const Document& document : exact) {
+                        if (document_words.at(document.id).count(rarest_word) > 0) {
+                            Assert(found_ids.count(document.id) > 0, hint + ": "s + to_string(document.id) + " with the rarest word is missing"s);
+                        }
+                    }
+                }
+                // The same budget gives the same documents, and a page is a slice of them
+                AssertIdenticalDocuments(search_server.FindTopDocuments(query, status, options).documents, result.documents, hint);
+                SearchOptions page = options;
+                page.offset = 1;
+                page.limit = 3;
+                const SearchResult page_result = search_server.FindTopDocuments(query, status, page);
+                ASSERT(page_result.is_approximate);
+                const size_t page_end = min<size_t>(result.documents.size(), 4);
+                AssertIdenticalDocuments(page_result.documents,
+                    vector<Document>(result.documents.begin() + min<size_t>(result.documents.size(), 1), result.documents.begin() + page_end), hint);
+            }
+
+            // A time budget may or may not run out, either way the documents are matches
+            options.max_postings = 0;
+            options.time_budget = chrono::microseconds(1);
+            const SearchResult timed = search_server.FindTopDocuments(query, status, options);
+            for (const Document& document : timed.documents) {
+                Assert(exact_relevance.count(document.id) > 0, query + ": "s + to_string(document.id) + " is not a match"s);
+                Assert(document.relevance <= exact_relevance.at(document.id) + 1e-12, query);
+            }
+            if (!timed.is_approximate) {
+                AssertIdenticalDocuments(timed.documents, exact, query);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void RunSearchPathTests(TestRunner& tr) {
+    RUN_TEST(tr, TestTieredPostingsEqualExactSearch);
+    RUN_TEST(tr, TestHotTermCacheEqualsExactSearch);
+    RUN_TEST(tr, TestBatchEqualsSingleQueries);
+    RUN_TEST(tr, TestBudgetExhaustedQueryIsPartial);
+}
@@ -0,0 +1,141 @@
+#include "tests.h"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <set>
+#include <string_view>
+#include "../search_server.h"
+#include "../stop_word_set.h"
+
+using namespace std;
+
+namespace {
+
+// Repeated and empty words are kept in the input on purpose
+constexpr array<string_view, 12> STOP_WORDS = {
+    "and"sv, "in"sv, "on"sv, "the"sv, "and"sv, ""sv, "a"sv, "of"sv, "with"sv, "the"sv,
+    "extraordinarily_long_stop_word_which_is_longer_than_sixty_three_characters"sv, "at"sv,
+};
+constexpr StaticStopWordSet STATIC_STOP_WORDS(STOP_WORDS);
+
+static_assert(STATIC_STOP_WORDS.Contains("and"sv));
+static_assert(STATIC_STOP_WORDS.Contains("a"sv));
+static_assert(!STATIC_STOP_WORDS.Contains(""sv));
+static_assert(!STATIC_STOP_WORDS.Contains("an"sv));
+
+vector<string> MakeProbeWords() {
+    vector<string> words = { ""s, "an"s, "ands"s, "And"s, "ther"s, "th"s, "o"s, "at "s, "w1"s, "cat"s,
+        "extraordinarily_long_stop_word_which_is_longer_than_sixty_three_characterz"s,
+        "extraordinarily_long_stop_word_which_is_longer_than_sixty_three_characters_"s };
+    for (const string_view word : STOP_WORDS) {
+        words.emplace_back(word);
+    }
+    for (int i = 0; i < 300; ++i) {
+        words.push_back("w"s + to_string(i));
+    }
+    return words;
+}
+
+// The table built at compile time, its run-time copy and a table built at run time from the same
+// words all agree with std::set, whatever repeated and empty words the input has
+void TestStaticStopWordsEqualRuntimeSet() {
+    const vector<string> runtime_words(STOP_WORDS.begin(), STOP_WORDS.end());
+    const StopWordSet runtime_set(runtime_words);
+    const StopWordSet copied_set(STATIC_STOP_WORDS);
+    const set<string> expected = MakeUniqueNonEmptyStrings(STOP_WORDS);
+    ASSERT_EQUAL(expected.size(), 9u);
+    for (const string& word : MakeProbeWords()) {
+        const bool is_stop_word = expected.count(word) > 0;
+        AssertEqual(STATIC_STOP_WORDS.Contains(word), is_stop_word, word);
+        AssertEqual(copied_set.Contains(word), is_stop_word, word);
+        AssertEqual(runtime_set.Contains(word), is_stop_word, word);
+    }
+
+    const StopWordSet empty_set(vector<string>{});
+    const StopWordSet only_empty_words(vector<string>{ ""s, ""s });
+    for (const string& word : MakeProbeWords()) {
+        ASSERT(!empty_set.Contains(word));
+        ASSERT(!only_empty_words.Contains(word));
+    }
+    ASSERT(!StopWordSet().Contains(""sv));
+}
+
+// Tables of many words still find every word and nothing else
+void TestLargeStopWordSet() {
+    vector<string> words;
+    for (int i = 0; i < 5000; i += 2) {
+        words.push_back("w"s + to_string(i));
+    }
+    words.push_back("w0"s);
+    const StopWordSet stop_words(words);
+    for (int i = 0; i < 5000; ++i) {
+        const string word = "w"s + to_string(i);
+        AssertEqual(stop_words.Contains(word), i % 2 == 0, word);
+    }
+}
+
+void TestInvalidStaticStopWords() {
+    ASSERT_THROWS(StaticStopWordSet(array{ "and"sv, "i\x01n"sv }), invalid_argument);
+}
+
+// A server built from the compile-time set indexes and searches exactly like one built from text
+void TestServerWithStaticStopWords() {
+    SearchServer static_server(STATIC_STOP_WORDS);
+    SearchServer text_server("and in on the a of with at extraordinarily_long_stop_word_which_is_longer_than_sixty_three_characters"s);
+    const vector<string> texts = { "the cat in the hat"s, "a dog with a collar"s, "cat and dog at home"s, "an ant on the hill"s };
+    for (size_t i = 0; i < texts.size(); ++i) {
+        static_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+        text_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 });
+    }
+    auto get_words = [](const SearchServer& search_server, int document_id) {
+        map<string_view, double> words;
+        for (const auto [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            words[word] = freq;
+        }
+        return words;
+    };
+    for (int document_id = 0; document_id < static_cast<int>(texts.size()); ++document_id) {
+        ASSERT_EQUAL(get_words(static_server, document_id), get_words(text_server, document_id));
+    }
+    for (const string& query : { "cat"s, "the cat"s, "an ant"s, "dog -with"s, "the and"s, "hat -a"s }) {
+        AssertIdenticalDocuments(static_server.FindTopDocuments(query), text_server.FindTopDocuments(query), query);
+        ASSERT_EQUAL(get<0>(static_server.MatchDocument(query, 0)), get<0>(text_server.MatchDocument(query, 0)));
+    }
+    ASSERT(static_server.FindTopDocuments("the"s).empty());
+}
+
+// The table of a server keeps its own words, so a server moved out of a destroyed one, or a table
+// which outlives the words it was built from, still tells stop words apart
+void TestMovedServerKeepsStopWords() {
+    auto words = make_unique<vector<string>>(vector<string>{ "and"s, "in"s, "the"s });
+    const StopWordSet stop_words(*words);
+    words.reset();
+    ASSERT(stop_words.Contains("the"sv));
+    ASSERT(!stop_words.Contains("cat"sv));
+
+    auto source = make_unique<SearchServer>("and in the"s);
+    source->AddDocument(1, "the cat in the hat"s, DocumentStatus::ACTUAL, { 1 });
+    SearchServer search_server(move(*source));
+    source.reset();
+    search_server.AddDocument(2, "a dog and the cat"s, DocumentStatus::ACTUAL, { 2 });
+    set<string_view> document_words;
+    for (const auto [word, freq] : search_server.GetWordFrequencies(2)) {
+        document_words.insert(word);
+    }
+    ASSERT_EQUAL(document_words, (set<string_view>{ "a"sv, "cat"sv, "dog"sv }));
+    ASSERT(search_server.FindTopDocuments("the and"s).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("the cat"s).size(), 2u);
+    ASSERT_THROWS(search_server.MatchDocument("the dog"s, 3), out_of_range);
+    ASSERT_EQUAL(get<0>(search_server.MatchDocument("the dog"s, 2)).size(), 1u);
+}
+
+} // namespace
+
+void RunStopWordTests(TestRunner& tr) {
+    RUN_TEST(tr, TestStaticStopWordsEqualRuntimeSet);
+    RUN_TEST(tr, TestLargeStopWordSet);
+    RUN_TEST(tr, TestInvalidStaticStopWords);
+    RUN_TEST(tr, TestServerWithStaticStopWords);
+    RUN_TEST(tr, TestMovedServerKeepsStopWords);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "../document.h"
+#include "../test_framework.h"
+
+using namespace std;
+
+// Same ids, ratings and order; relevances may differ by ACCURACY
+void AssertSameDocuments(const vector<Document>& actual, const vector<Document>& expected, const string& hint);
+// Same as AssertSameDocuments, but relevances must be equal to the last bit
+void AssertIdenticalDocuments(const vector<Document>& actual, const vector<Document>& expected, const string& hint);
+
+// Deterministic texts over a dictionary of dictionary_size words "w0", "w1", ..., where
+// small numbers are more frequent. Queries may contain -minus words
+vector<string> GenerateTestTexts(uint64_t seed, size_t count, size_t word_count, size_t dictionary_size);
+vector<string> GenerateTestQueries(uint64_t seed, size_t count, size_t word_count, size_t dictionary_size);
+
+class SearchServer;
+
+// Adds texts[i] under id i * 2 + 1 with a status and a rating taken from i; every fourth
+// document is ACTUAL only when all_actual is false
+void AddTestDocuments(SearchServer& search_server, const vector<string>& texts, bool all_actual = false);
+
+// Brute-force TF-IDF over the ACTUAL documents of AddTestDocuments(texts, all_actual) without stop
+// words: the relevance is the sum of weight * tf * idf of the weighted words of the document.
+// Documents without weighted words or with a minus word are skipped, all the rest are ranked
+vector<Document> RankTestTexts(const vector<string>& texts, bool all_actual, const map<string, double>& word_weights,
+    const set<string>& minus_words = {});
+
+void RunNearDuplicateTests(TestRunner& tr);
+void RunMatchDocumentsTests(TestRunner& tr);
+void RunPaginationTests(TestRunner& tr);
+void RunQuerySyntaxTests(TestRunner& tr);
+void RunRankingTests(TestRunner& tr);
+void RunFilterTests(TestRunner& tr);
+void RunSearchPathTests(TestRunner& tr);
+void RunBulkLoaderTests(TestRunner& tr);
+void RunDiskIndexTests(TestRunner& tr);
+void RunRequestQueueTests(TestRunner& tr);
+void RunSearchMetricsTests(TestRunner& tr);
+void RunMemoryTests(TestRunner& tr);
+void RunStopWordTests(TestRunner& tr);